@@ -14,6 +14,7 @@
 ///
 
 #pragma once
+#include <exception>
 #include <functional>
 #include <type_traits>
 #include <utility>
@@ -1275,6 +1276,78 @@ struct expected_delete_assign_base<T, E, false, false> {
 
 } // namespace detail
 
+// Turns the exception being handled into an E; called from inside a catch
+// block, so it may rethrow to inspect the exception. The default keeps
+// exception_ptr or catches E itself, and lets anything else propagate.
+// Specialize it, or pass another translator to try_invoke, for other mappings.
+template <class E> struct exception_translator {
+  E operator()() const {
+    if constexpr (is_same_v<E, exception_ptr>) {
+      return current_exception();
+    } else {
+      try {
+        throw;
+      } catch (E &e) {
+        return move(e);
+      }
+    }
+  }
+};
+
+// Calls f(args...) and returns its result as expected<R, E>, with a thrown
+// exception translated into the error. If the call is noexcept this is a
+// plain call, without a try block.
+template <class E, class Translator = exception_translator<E>, class F,
+          class... Args, class Ret = invoke_result_t<F, Args...>,
+          class Result = expected<conditional_t<is_void_v<Ret>, void,
+                                                decay_t<Ret>>,
+                                  E>>
+Result try_invoke(F &&f, Args &&...args) {
+  if constexpr (is_nothrow_invocable_v<F, Args...>) {
+    if constexpr (is_void_v<Ret>) {
+      invoke(forward<F>(f), forward<Args>(args)...);
+      return Result();
+    } else {
+      return Result(invoke(forward<F>(f), forward<Args>(args)...));
+    }
+  } else {
+    try {
+      if constexpr (is_void_v<Ret>) {
+        invoke(forward<F>(f), forward<Args>(args)...);
+        return Result();
+      } else {
+        return Result(invoke(forward<F>(f), forward<Args>(args)...));
+      }
+    } catch (...) {
+      return Result(unexpect, Translator()());
+    }
+  }
+}
+
+namespace detail {
+
+template <class Translator, class Exp, class F,
+          class T = typename decay_t<Exp>::value_type,
+          class E = typename decay_t<Exp>::error_type>
+auto expected_map_catching_impl(Exp &&exp, F &&f) {
+  if constexpr (is_void_v<T>) {
+    using Result = decltype(try_invoke<E, Translator>(forward<F>(f)));
+    if (exp.has_value()) {
+      return try_invoke<E, Translator>(forward<F>(f));
+    }
+    return Result(unexpect, forward<Exp>(exp).error());
+  } else {
+    using Result =
+        decltype(try_invoke<E, Translator>(forward<F>(f), *forward<Exp>(exp)));
+    if (exp.has_value()) {
+      return try_invoke<E, Translator>(forward<F>(f), *forward<Exp>(exp));
+    }
+    return Result(unexpect, forward<Exp>(exp).error());
+  }
+}
+
+} // namespace detail
+
 template <class T, class E>
 class expected : public detail::expected_move_assign_base<T, E>,
                  private detail::expected_delete_ctor_base<T, E>,
@@ -1597,6 +1670,29 @@ public:
     return detail::expected_map_impl(move(*this), forward<F>(f));
   }
 
+  // Like map, but an exception thrown by f becomes the error, by way of
+  // Translator, which comes first so that F is still deduced.
+  template <class Translator = exception_translator<E>, class F>
+  auto map_catching(F &&f) & {
+    return detail::expected_map_catching_impl<Translator>(*this,
+                                                          forward<F>(f));
+  }
+  template <class Translator = exception_translator<E>, class F>
+  auto map_catching(F &&f) && {
+    return detail::expected_map_catching_impl<Translator>(move(*this),
+                                                          forward<F>(f));
+  }
+  template <class Translator = exception_translator<E>, class F>
+  auto map_catching(F &&f) const & {
+    return detail::expected_map_catching_impl<Translator>(*this,
+                                                          forward<F>(f));
+  }
+  template <class Translator = exception_translator<E>, class F>
+  auto map_catching(F &&f) const && {
+    return detail::expected_map_catching_impl<Translator>(move(*this),
+                                                          forward<F>(f));
+  }
+
   template <class F> constexpr auto map_error(F &&f) & {
     return detail::expected_map_error_impl(*this, forward<F>(f));
   }
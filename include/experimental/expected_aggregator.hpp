@@ -0,0 +1,188 @@
+// SPDX-License-Identifier: CC0-1.0
+///
+// expected - An c++17 implementation of std::expected with extensions
+//
+// To the extent possible under law, the author(s) have dedicated all
+// copyright and related and neighboring rights to this software to the
+// public domain worldwide. This software is distributed without any warranty.
+//
+// You should have received a copy of the CC0 Public Domain Dedication
+// along with this software. If not, see
+// <http://creativecommons.org/publicdomain/zero/1.0/>.
+///
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <experimental/expected.hpp>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace std::experimental {
+inline namespace fundamentals_v3 {
+
+namespace detail {
+
+struct error_identity {
+  template <class E> constexpr const E &operator()(const E &e) const noexcept {
+    return e;
+  }
+};
+
+// Threads get consecutive indices, so up to shard count threads never share
+// a shard.
+inline size_t aggregator_thread_index() noexcept {
+  static atomic<size_t> next{0};
+  static thread_local const size_t index =
+      next.fetch_add(1, memory_order_relaxed);
+  return index;
+}
+
+inline constexpr size_t aggregator_cache_line = 64;
+
+} // namespace detail
+
+// Counts errors by key from many threads. Each thread records into its own
+// cache line aligned shard, so the shard locks are normally uncontended; the
+// shards are only merged when a summary is asked for. For every key the first
+// samples_per_key errors are kept whole.
+template <class E, class KeyFn = detail::error_identity,
+          class Hash = hash<detail::remove_cvref_t<
+              invoke_result_t<const KeyFn &, const E &>>>>
+class error_aggregator {
+public:
+  using error_type = E;
+  using key_type =
+      detail::remove_cvref_t<invoke_result_t<const KeyFn &, const E &>>;
+
+  struct entry {
+    key_type key;
+    size_t count;
+    vector<E> samples;
+  };
+
+private:
+  struct counts {
+    size_t m_count = 0;
+    vector<E> m_samples;
+  };
+
+  struct alignas(detail::aggregator_cache_line) shard {
+    mutable mutex m_mutex;
+    unordered_map<key_type, counts, Hash> m_counts;
+  };
+
+  unique_ptr<shard[]> m_shards;
+  size_t m_shard_count;
+  size_t m_samples_per_key;
+  KeyFn m_key;
+
+  shard &local_shard() noexcept {
+    return m_shards[detail::aggregator_thread_index() % m_shard_count];
+  }
+
+  template <class G> void add(G &&error) {
+    shard &s = local_shard();
+    key_type key = invoke(m_key, as_const(error));
+    lock_guard<mutex> lock(s.m_mutex);
+    counts &c = s.m_counts[move(key)];
+    ++c.m_count;
+    if (c.m_samples.size() < m_samples_per_key) {
+      c.m_samples.emplace_back(forward<G>(error));
+    }
+  }
+
+public:
+  explicit error_aggregator(
+      size_t samples_per_key = 4,
+      size_t shards = max<size_t>(1, thread::hardware_concurrency()),
+      KeyFn key = KeyFn())
+      : m_shards(new shard[max<size_t>(1, shards)]),
+        m_shard_count(max<size_t>(1, shards)),
+        m_samples_per_key(samples_per_key), m_key(move(key)) {}
+
+  void record(unexpected<E> &&error) { add(move(error).value()); }
+  void record(const unexpected<E> &error) { add(error.value()); }
+
+  // Records the error of a result, if it has one, and returns whether it
+  // held a value.
+  template <class T> bool record(expected<T, E> &&result) {
+    if (result) {
+      return true;
+    }
+    add(move(result).error());
+    return false;
+  }
+  template <class T> bool record(const expected<T, E> &result) {
+    if (result) {
+      return true;
+    }
+    add(result.error());
+    return false;
+  }
+
+  // Merges the shards; entries are in no particular order.
+  vector<entry> snapshot() const {
+    unordered_map<key_type, counts, Hash> merged;
+    for (size_t i = 0; i < m_shard_count; ++i) {
+      const shard &s = m_shards[i];
+      lock_guard<mutex> lock(s.m_mutex);
+      for (const auto &[key, c] : s.m_counts) {
+        counts &m = merged[key];
+        m.m_count += c.m_count;
+        for (auto it = c.m_samples.begin();
+             it != c.m_samples.end() && m.m_samples.size() < m_samples_per_key;
+             ++it) {
+          m.m_samples.push_back(*it);
+        }
+      }
+    }
+    vector<entry> entries;
+    entries.reserve(merged.size());
+    for (auto &[key, c] : merged) {
+      entries.push_back(entry{key, c.m_count, move(c.m_samples)});
+    }
+    return entries;
+  }
+
+  // The k most frequent keys, most frequent first.
+  vector<entry> top_k(size_t k) const {
+    vector<entry> entries = snapshot();
+    auto by_count = [](const entry &x, const entry &y) {
+      return x.count > y.count;
+    };
+    if (k < entries.size()) {
+      partial_sort(entries.begin(), entries.begin() + k, entries.end(),
+                   by_count);
+      entries.erase(entries.begin() + k, entries.end());
+    } else {
+      sort(entries.begin(), entries.end(), by_count);
+    }
+    return entries;
+  }
+
+  size_t total() const {
+    size_t sum = 0;
+    for (size_t i = 0; i < m_shard_count; ++i) {
+      const shard &s = m_shards[i];
+      lock_guard<mutex> lock(s.m_mutex);
+      for (const auto &kv : s.m_counts) {
+        sum += kv.second.m_count;
+      }
+    }
+    return sum;
+  }
+
+  void clear() {
+    for (size_t i = 0; i < m_shard_count; ++i) {
+      lock_guard<mutex> lock(m_shards[i].m_mutex);
+      m_shards[i].m_counts.clear();
+    }
+  }
+};
+
+} // namespace fundamentals_v3
+} // namespace std::experimental
@@ -0,0 +1,115 @@
+// SPDX-License-Identifier: CC0-1.0
+///
+// expected - An c++17 implementation of std::expected with extensions
+//
+// To the extent possible under law, the author(s) have dedicated all
+// copyright and related and neighboring rights to this software to the
+// public domain worldwide. This software is distributed without any warranty.
+//
+// You should have received a copy of the CC0 Public Domain Dedication
+// along with this software. If not, see
+// <http://creativecommons.org/publicdomain/zero/1.0/>.
+///
+
+#pragma once
+#include <experimental/expected.hpp>
+#include <iterator>
+
+namespace std::experimental {
+inline namespace fundamentals_v3 {
+
+namespace detail {
+
+template <class R>
+using algorithm_reference_t = decltype(*begin(declval<R &>()));
+
+template <class F, class R, class... Args>
+using algorithm_result_t =
+    remove_cvref_t<invoke_result_t<F &, Args..., algorithm_reference_t<R>>>;
+
+template <class R, class Pred>
+using predicate_result_t = algorithm_result_t<Pred, R>;
+
+template <class R>
+using first_success_result_t =
+    remove_cvref_t<invoke_result_t<algorithm_reference_t<R>>>;
+
+template <bool Any, class R, class Pred>
+predicate_result_t<R, Pred> expected_any_all(R &&r, Pred &pred) {
+  using Ret = predicate_result_t<R, Pred>;
+  static_assert(is_expected_v<Ret>, "Pred must return an expected");
+  static_assert(is_same_v<typename Ret::value_type, bool>,
+                "Pred must return an expected<bool, E>");
+  for (auto &&elem : r) {
+    Ret ret = invoke(pred, forward<decltype(elem)>(elem));
+    if (!ret || *ret == Any) {
+      return ret;
+    }
+  }
+  return Ret(!Any);
+}
+
+} // namespace detail
+
+// Left fold where f(acc, elem) returns expected<Acc, E>. The accumulator is
+// moved into each call and out of its result; the first error ends the fold.
+template <class R, class Acc, class F>
+auto fold_expected(R &&r, Acc init, F f)
+    -> detail::algorithm_result_t<F, R, Acc &&> {
+  using Ret = detail::algorithm_result_t<F, R, Acc &&>;
+  static_assert(detail::is_expected_v<Ret>, "F must return an expected");
+  static_assert(is_same_v<typename Ret::value_type, Acc>,
+                "F must return an expected of the accumulator type");
+  for (auto &&elem : r) {
+    Ret ret = invoke(f, move(init), forward<decltype(elem)>(elem));
+    if (!ret) {
+      return ret;
+    }
+    init = move(*ret);
+  }
+  return Ret(in_place, move(init));
+}
+
+// Calls each thunk in order and returns the first value. Only the latest
+// failure is kept alive; if every thunk fails its error is returned, and an
+// empty range yields the error built from if_empty.
+template <class R, class G>
+detail::first_success_result_t<R> first_success(R &&r, G &&if_empty) {
+  using Ret = detail::first_success_result_t<R>;
+  static_assert(detail::is_expected_v<Ret>, "thunks must return an expected");
+  auto first = begin(r);
+  const auto last = end(r);
+  if (first == last) {
+    return Ret(unexpect, forward<G>(if_empty));
+  }
+  for (;;) {
+    Ret ret = invoke(*first);
+    if (ret || ++first == last) {
+      return ret;
+    }
+  }
+}
+
+// As above, with a value initialized error for an empty range; only for
+// default constructible error types.
+template <class R, class Ret = detail::first_success_result_t<R>,
+          enable_if_t<is_default_constructible_v<typename Ret::error_type>> * =
+              nullptr>
+Ret first_success(R &&r) {
+  return first_success(forward<R>(r), typename Ret::error_type());
+}
+
+// pred(elem) returns expected<bool, E>; evaluation stops at the first error or
+// at the first element that decides the answer.
+template <class R, class Pred>
+detail::predicate_result_t<R, Pred> all_of_expected(R &&r, Pred pred) {
+  return detail::expected_any_all<false>(forward<R>(r), pred);
+}
+
+template <class R, class Pred>
+detail::predicate_result_t<R, Pred> any_of_expected(R &&r, Pred pred) {
+  return detail::expected_any_all<true>(forward<R>(r), pred);
+}
+
+} // namespace fundamentals_v3
+} // namespace std::experimental
@@ -0,0 +1,239 @@
+// SPDX-License-Identifier: CC0-1.0
+///
+// expected - An c++17 implementation of std::expected with extensions
+//
+// To the extent possible under law, the author(s) have dedicated all
+// copyright and related and neighboring rights to this software to the
+// public domain worldwide. This software is distributed without any warranty.
+//
+// You should have received a copy of the CC0 Public Domain Dedication
+// along with this software. If not, see
+// <http://creativecommons.org/publicdomain/zero/1.0/>.
+///
+
+#pragma once
+#include <cstdint>
+#include <exception>
+#include <experimental/expected.hpp>
+#include <experimental/expected_error_domain.hpp>
+#include <new>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace std::experimental {
+inline namespace fundamentals_v3 {
+
+namespace detail {
+
+struct any_error_vtable {
+  void (*copy)(const void *from, void *to);
+  void (*move)(void *from, void *to) noexcept;
+  void (*destroy)(void *storage) noexcept;
+  string (*message)(const void *storage);
+  int64_t (*code)(const void *storage) noexcept;
+};
+
+template <class T> struct is_unexpected_type : false_type {};
+template <class E> struct is_unexpected_type<unexpected<E>> : true_type {};
+
+template <class E, class = void> struct has_message_member : false_type {};
+template <class E>
+struct has_message_member<E, void_t<decltype(declval<const E &>().message())>>
+    : true_type {};
+
+template <class E, class = void> struct has_code_member : false_type {};
+template <class E>
+struct has_code_member<E, void_t<decltype(declval<const E &>().code())>>
+    : true_type {};
+
+template <class E> int64_t any_error_code(const E &e) noexcept {
+  if constexpr (is_enum_v<E>) {
+    return static_cast<int64_t>(static_cast<underlying_type_t<E>>(e));
+  } else if constexpr (is_integral_v<E>) {
+    return static_cast<int64_t>(e);
+  } else if constexpr (has_code_member<E>::value) {
+    return any_error_code(e.code());
+  } else if constexpr (is_same_v<E, error_code>) {
+    return e.value();
+  } else {
+    return 0;
+  }
+}
+
+template <class E> string any_error_message(const E &e) {
+  if constexpr (is_error_domain_v<E>) {
+    return string(error_message(e));
+  } else if constexpr (has_message_member<E>::value) {
+    return string(e.message());
+  } else if constexpr (is_base_of_v<exception, E>) {
+    return e.what();
+  } else if constexpr (is_convertible_v<const E &, string_view>) {
+    return string(string_view(e));
+  } else {
+    return string();
+  }
+}
+
+} // namespace detail
+
+// Holds an error of any copyable type. Types of up to inline_size bytes (enough
+// for a std::string) with a non-throwing move are stored inline; only larger
+// ones are allocated. A static table per type copies, moves and destroys the
+// payload and reports its message() and code():
+//   - code() is the value of an enum or integer, of error_code::value(), or
+//     of a code() member; 0 otherwise.
+//   - message() comes from an error_domain table, a message() member, what()
+//     for exceptions, or the text of a string; empty otherwise.
+class any_error {
+public:
+  static constexpr size_t inline_size = 32;
+
+  template <class E>
+  static constexpr bool fits_inline =
+      sizeof(E) <= inline_size && alignof(E) <= alignof(max_align_t) &&
+      alignof(E) <= alignof(void *) && is_nothrow_move_constructible_v<E>;
+
+private:
+  alignas(void *) unsigned char m_storage[inline_size];
+  const detail::any_error_vtable *m_vtable = nullptr;
+
+  template <class E> struct ops {
+    static const E &get(const void *storage) noexcept {
+      if constexpr (fits_inline<E>) {
+        return *launder(static_cast<const E *>(storage));
+      } else {
+        return **static_cast<E *const *>(storage);
+      }
+    }
+    static E &get(void *storage) noexcept {
+      return const_cast<E &>(get(static_cast<const void *>(storage)));
+    }
+
+    template <class... Args> static void create(void *storage, Args &&...args) {
+      if constexpr (fits_inline<E>) {
+        new (storage) E(forward<Args>(args)...);
+      } else {
+        new (storage) E *(new E(forward<Args>(args)...));
+      }
+    }
+    static void copy(const void *from, void *to) { create(to, get(from)); }
+    static void move(void *from, void *to) noexcept {
+      if constexpr (fits_inline<E>) {
+        new (to) E(std::move(get(from)));
+        get(from).~E();
+      } else {
+        new (to) E *(*static_cast<E **>(from));
+      }
+    }
+    static void destroy(void *storage) noexcept {
+      if constexpr (fits_inline<E>) {
+        get(storage).~E();
+      } else {
+        delete *static_cast<E **>(storage);
+      }
+    }
+    static string message(const void *storage) {
+      return detail::any_error_message(get(storage));
+    }
+    static int64_t code(const void *storage) noexcept {
+      return detail::any_error_code(get(storage));
+    }
+
+    static constexpr detail::any_error_vtable vtable = {
+        &copy, &move, &destroy, &message, &code};
+  };
+
+  template <class E, class D = detail::remove_cvref_t<E>>
+  using enable_payload =
+      enable_if_t<!is_same_v<D, any_error> && !is_same_v<D, in_place_t> &&
+                  !detail::is_unexpected_type<D>::value &&
+                  is_copy_constructible_v<D>>;
+
+  template <class E, class D = detail::remove_cvref_t<E>>
+  static constexpr bool nothrow_payload =
+      fits_inline<D> && is_nothrow_constructible_v<D, E>;
+
+public:
+  // An empty error, with code 0 and no message.
+  any_error() noexcept = default;
+
+  // Does not throw when the payload is stored inline and constructing it does
+  // not throw, so expected<T, any_error> can be assigned such errors.
+  template <class E, enable_payload<E> * = nullptr>
+  any_error(E &&error) noexcept(nothrow_payload<E>) {
+    emplace<detail::remove_cvref_t<E>>(forward<E>(error));
+  }
+  template <class E, enable_payload<E> * = nullptr>
+  any_error(const unexpected<E> &error) noexcept(nothrow_payload<const E &>)
+      : any_error(error.value()) {}
+  template <class E, enable_payload<E> * = nullptr>
+  any_error(unexpected<E> &&error) noexcept(nothrow_payload<E>)
+      : any_error(std::move(error).value()) {}
+
+  any_error(const any_error &other) : m_vtable(other.m_vtable) {
+    if (m_vtable) {
+      m_vtable->copy(other.m_storage, m_storage);
+    }
+  }
+  any_error(any_error &&other) noexcept : m_vtable(other.m_vtable) {
+    if (m_vtable) {
+      m_vtable->move(other.m_storage, m_storage);
+      other.m_vtable = nullptr;
+    }
+  }
+  any_error &operator=(const any_error &other) {
+    if (this != &other) {
+      any_error copy(other);
+      *this = std::move(copy);
+    }
+    return *this;
+  }
+  any_error &operator=(any_error &&other) noexcept {
+    if (this != &other) {
+      reset();
+      if ((m_vtable = other.m_vtable)) {
+        m_vtable->move(other.m_storage, m_storage);
+        other.m_vtable = nullptr;
+      }
+    }
+    return *this;
+  }
+  ~any_error() { reset(); }
+
+  template <class E, class... Args> E &emplace(Args &&...args) {
+    reset();
+    ops<E>::create(m_storage, forward<Args>(args)...);
+    m_vtable = &ops<E>::vtable;
+    return ops<E>::get(m_storage);
+  }
+
+  void reset() noexcept {
+    if (m_vtable) {
+      exchange(m_vtable, nullptr)->destroy(m_storage);
+    }
+  }
+
+  bool has_value() const noexcept { return m_vtable != nullptr; }
+
+  template <class E> bool holds() const noexcept {
+    return m_vtable == &ops<E>::vtable;
+  }
+  // The payload if it has type E, otherwise null.
+  template <class E> const E *target() const noexcept {
+    return holds<E>() ? &ops<E>::get(m_storage) : nullptr;
+  }
+  template <class E> E *target() noexcept {
+    return holds<E>() ? &ops<E>::get(m_storage) : nullptr;
+  }
+
+  string message() const {
+    return m_vtable ? m_vtable->message(m_storage) : string();
+  }
+  int64_t code() const noexcept {
+    return m_vtable ? m_vtable->code(m_storage) : 0;
+  }
+};
+
+} // namespace fundamentals_v3
+} // namespace std::experimental
@@ -0,0 +1,284 @@
+// SPDX-License-Identifier: CC0-1.0
+///
+// expected - An c++17 implementation of std::expected with extensions
+//
+// To the extent possible under law, the author(s) have dedicated all
+// copyright and related and neighboring rights to this software to the
+// public domain worldwide. This software is distributed without any warranty.
+//
+// You should have received a copy of the CC0 Public Domain Dedication
+// along with this software. If not, see
+// <http://creativecommons.org/publicdomain/zero/1.0/>.
+///
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <experimental/expected.hpp>
+#include <new>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define EXPECTED_ATOMIC_CX16 1
+#include <immintrin.h>
+#endif
+
+namespace std::experimental {
+inline namespace fundamentals_v3 {
+
+namespace detail {
+
+template <size_t N> class atomic_word;
+
+template <> class atomic_word<8> {
+  atomic<uint64_t> m_word;
+
+public:
+  using word_type = uint64_t;
+  static_assert(atomic<uint64_t>::is_always_lock_free);
+
+  explicit atomic_word(word_type w) noexcept : m_word(w) {}
+
+  word_type load(memory_order order) const noexcept {
+    return m_word.load(order);
+  }
+  void store(word_type w, memory_order order) noexcept {
+    m_word.store(w, order);
+  }
+  word_type exchange(word_type w, memory_order order) noexcept {
+    return m_word.exchange(w, order);
+  }
+  bool compare_exchange_weak(word_type &expected, word_type desired,
+                             memory_order success,
+                             memory_order failure) noexcept {
+    return m_word.compare_exchange_weak(expected, desired, success, failure);
+  }
+  bool compare_exchange_strong(word_type &expected, word_type desired,
+                               memory_order success,
+                               memory_order failure) noexcept {
+    return m_word.compare_exchange_strong(expected, desired, success, failure);
+  }
+};
+
+#if defined(EXPECTED_ATOMIC_CX16)
+// std::atomic of 16 bytes goes through libatomic and is not reported as lock
+// free, so the double width word uses cmpxchg16b directly. Every write is a
+// full barrier. Intel and AMD guarantee that aligned 16 byte SSE loads are
+// atomic on processors with AVX, so loads there are plain reads; without AVX
+// a load is a compare-exchange that never changes the value, which still
+// writes the cache line.
+template <> class atomic_word<16> {
+  alignas(16) unsigned __int128 m_word;
+
+  __attribute__((target("cx16"))) unsigned __int128
+  cas(unsigned __int128 expected, unsigned __int128 desired) const noexcept {
+    return __sync_val_compare_and_swap(
+        const_cast<unsigned __int128 *>(&m_word), expected, desired);
+  }
+
+  // One vmovdqa, which the compiler must neither split nor move.
+  __attribute__((target("avx"))) unsigned __int128 read() const noexcept {
+    __m128i v;
+    __asm__ __volatile__("vmovdqa %1, %0" : "=x"(v) : "m"(m_word) : "memory");
+    unsigned __int128 w;
+    memcpy(&w, &v, sizeof(w));
+    return w;
+  }
+
+  static bool plain_loads() noexcept {
+    static const bool avx = __builtin_cpu_supports("avx");
+    return avx;
+  }
+
+public:
+  using word_type = unsigned __int128;
+
+  explicit atomic_word(word_type w) noexcept : m_word(w) {}
+
+  // x86 loads are acquire loads, and every store is a locked instruction, so
+  // a plain load is also sequentially consistent.
+  word_type load(memory_order) const noexcept {
+    return plain_loads() ? read() : cas(0, 0);
+  }
+  void store(word_type w, memory_order order) noexcept { exchange(w, order); }
+  word_type exchange(word_type w, memory_order order) noexcept {
+    word_type cur = load(order);
+    for (;;) {
+      const word_type seen = cas(cur, w);
+      if (seen == cur) {
+        return seen;
+      }
+      cur = seen;
+    }
+  }
+  bool compare_exchange_weak(word_type &expected, word_type desired,
+                             memory_order success,
+                             memory_order failure) noexcept {
+    return compare_exchange_strong(expected, desired, success, failure);
+  }
+  bool compare_exchange_strong(word_type &expected, word_type desired,
+                               memory_order, memory_order) noexcept {
+    const word_type seen = cas(expected, desired);
+    if (seen == expected) {
+      return true;
+    }
+    expected = seen;
+    return false;
+  }
+};
+#endif
+
+template <class T> constexpr size_t atomic_payload_size() noexcept {
+  if constexpr (is_void_v<T>) {
+    return 0;
+  } else {
+    return sizeof(T);
+  }
+}
+
+// The payload bytes are followed by zero padding and a has_value flag in the
+// last byte, so equal contents always give equal words.
+template <class T, class E> struct atomic_expected_traits {
+  static constexpr size_t payload_size =
+      atomic_payload_size<T>() > sizeof(E) ? atomic_payload_size<T>()
+                                           : sizeof(E);
+  static constexpr size_t word_size = payload_size < 8 ? 8 : 16;
+#if defined(EXPECTED_ATOMIC_CX16)
+  static constexpr size_t max_payload_size = 15;
+#else
+  static constexpr size_t max_payload_size = 7;
+#endif
+  static_assert(payload_size <= max_payload_size,
+                "T and E don't fit in a lock-free atomic word");
+  static_assert((is_void_v<T> || is_trivially_copyable_v<T>) &&
+                    is_trivially_copyable_v<E>,
+                "T and E must be trivially copyable");
+
+  using word_type = typename atomic_word<word_size>::word_type;
+
+  template <class U> static U read(const unsigned char *bytes) noexcept {
+    alignas(U) unsigned char buf[sizeof(U)];
+    memcpy(buf, bytes, sizeof(U));
+    return *launder(reinterpret_cast<U *>(buf));
+  }
+
+  static word_type encode(const expected<T, E> &exp) noexcept {
+    unsigned char bytes[word_size] = {};
+    if (exp.has_value()) {
+      if constexpr (!is_void_v<T>) {
+        memcpy(bytes, addressof(*exp), sizeof(T));
+      }
+      bytes[word_size - 1] = 1;
+    } else {
+      memcpy(bytes, addressof(exp.error()), sizeof(E));
+    }
+    word_type w;
+    memcpy(&w, bytes, word_size);
+    return w;
+  }
+
+  static expected<T, E> decode(word_type w) noexcept {
+    unsigned char bytes[word_size];
+    memcpy(bytes, &w, word_size);
+    if (bytes[word_size - 1] == 0) {
+      return expected<T, E>(unexpect, read<E>(bytes));
+    }
+    if constexpr (is_void_v<T>) {
+      return expected<T, E>();
+    } else {
+      return expected<T, E>(in_place, read<T>(bytes));
+    }
+  }
+};
+
+constexpr memory_order atomic_failure_order(memory_order order) noexcept {
+  return order == memory_order_acq_rel   ? memory_order_acquire
+         : order == memory_order_release ? memory_order_relaxed
+                                         : order;
+}
+
+} // namespace detail
+
+// An expected<T, E> held in a single lock-free word of 8 or 16 bytes. T and E
+// must be trivially copyable and leave room for the flag byte. Payloads of up
+// to 7 bytes use the 8 byte word, where loads are plain reads. Larger ones use
+// the 16 byte form, which needs cmpxchg16b; there a load is a plain read only
+// on processors with AVX, and otherwise a compare-exchange, which writes the
+// cache line, contends with other readers and faults on read-only memory.
+// compare_exchange compares the bytes of the stored alternative, like
+// std::atomic does.
+template <class T, class E> class atomic_expected {
+  using traits = detail::atomic_expected_traits<T, E>;
+  using word_type = typename traits::word_type;
+
+  detail::atomic_word<traits::word_size> m_word;
+
+public:
+  using value_type = expected<T, E>;
+  static constexpr bool is_always_lock_free = true;
+
+  atomic_expected() noexcept : m_word(traits::encode(value_type())) {}
+  atomic_expected(const value_type &desired) noexcept
+      : m_word(traits::encode(desired)) {}
+  atomic_expected(const atomic_expected &) = delete;
+  atomic_expected &operator=(const atomic_expected &) = delete;
+
+  atomic_expected &operator=(const value_type &desired) noexcept {
+    store(desired);
+    return *this;
+  }
+  operator value_type() const noexcept { return load(); }
+
+  bool is_lock_free() const noexcept { return true; }
+
+  value_type load(memory_order order = memory_order_seq_cst) const noexcept {
+    return traits::decode(m_word.load(order));
+  }
+  void store(const value_type &desired,
+             memory_order order = memory_order_seq_cst) noexcept {
+    m_word.store(traits::encode(desired), order);
+  }
+  value_type exchange(const value_type &desired,
+                      memory_order order = memory_order_seq_cst) noexcept {
+    return traits::decode(m_word.exchange(traits::encode(desired), order));
+  }
+
+  bool compare_exchange_weak(value_type &expected, const value_type &desired,
+                             memory_order success,
+                             memory_order failure) noexcept {
+    word_type w = traits::encode(expected);
+    if (m_word.compare_exchange_weak(w, traits::encode(desired), success,
+                                     failure)) {
+      return true;
+    }
+    expected = traits::decode(w);
+    return false;
+  }
+  bool compare_exchange_weak(
+      value_type &expected, const value_type &desired,
+      memory_order order = memory_order_seq_cst) noexcept {
+    return compare_exchange_weak(expected, desired, order,
+                                 detail::atomic_failure_order(order));
+  }
+
+  bool compare_exchange_strong(value_type &expected, const value_type &desired,
+                               memory_order success,
+                               memory_order failure) noexcept {
+    word_type w = traits::encode(expected);
+    if (m_word.compare_exchange_strong(w, traits::encode(desired), success,
+                                       failure)) {
+      return true;
+    }
+    expected = traits::decode(w);
+    return false;
+  }
+  bool compare_exchange_strong(
+      value_type &expected, const value_type &desired,
+      memory_order order = memory_order_seq_cst) noexcept {
+    return compare_exchange_strong(expected, desired, order,
+                                   detail::atomic_failure_order(order));
+  }
+};
+
+} // namespace fundamentals_v3
+} // namespace std::experimental
@@ -0,0 +1,190 @@
+// SPDX-License-Identifier: CC0-1.0
+///
+// expected - An c++17 implementation of std::expected with extensions
+//
+// To the extent possible under law, the author(s) have dedicated all
+// copyright and related and neighboring rights to this software to the
+// public domain worldwide. This software is distributed without any warranty.
+//
+// You should have received a copy of the CC0 Public Domain Dedication
+// along with this software. If not, see
+// <http://creativecommons.org/publicdomain/zero/1.0/>.
+///
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <experimental/expected.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if __has_include(<execinfo.h>)
+#include <execinfo.h>
+#define EXPECTED_HAS_BACKTRACE 1
+#else
+#define EXPECTED_HAS_BACKTRACE 0
+#endif
+
+namespace std::experimental {
+inline namespace fundamentals_v3 {
+
+// Return addresses of a captured stack, innermost first. Symbols are only
+// looked up by symbolize().
+class backtrace_frames {
+public:
+  static constexpr size_t max_frames = 32;
+
+private:
+  void *m_frames[max_frames];
+  size_t m_size = 0;
+
+public:
+  // Skips the innermost skip frames besides capture() itself. Returns null
+  // where stack walking is not available.
+  static shared_ptr<const backtrace_frames> capture(size_t skip = 0) {
+#if EXPECTED_HAS_BACKTRACE
+    auto trace = make_shared<backtrace_frames>();
+    const int n = ::backtrace(trace->m_frames, static_cast<int>(max_frames));
+    const size_t drop = min(static_cast<size_t>(n), skip + 1);
+    copy(trace->m_frames + drop, trace->m_frames + n, trace->m_frames);
+    trace->m_size = static_cast<size_t>(n) - drop;
+    return trace;
+#else
+    static_cast<void>(skip);
+    return nullptr;
+#endif
+  }
+
+  void *const *begin() const noexcept { return m_frames; }
+  void *const *end() const noexcept { return m_frames + m_size; }
+  size_t size() const noexcept { return m_size; }
+
+  // One line per frame, as far as the platform can name them.
+  vector<string> symbolize() const {
+    vector<string> lines;
+#if EXPECTED_HAS_BACKTRACE
+    char **symbols = ::backtrace_symbols(m_frames, static_cast<int>(m_size));
+    if (symbols) {
+      lines.assign(symbols, symbols + m_size);
+      ::free(symbols);
+    }
+#endif
+    return lines;
+  }
+};
+
+// Samples every n-th error at a call site, starting with the first. An
+// unsampled error costs one relaxed increment.
+class one_in_sampler {
+  atomic<uint32_t> m_count{0};
+  uint32_t m_n;
+
+public:
+  explicit one_in_sampler(uint32_t n) noexcept : m_n(n ? n : 1) {}
+  bool sample() noexcept {
+    return m_count.fetch_add(1, memory_order_relaxed) % m_n == 0;
+  }
+};
+
+// Samples at most burst errors at once, refilled at per_second. Implemented
+// as a generic cell rate algorithm: one atomic holds the time at which the
+// bucket will be full again.
+class token_bucket_sampler {
+  using clock = chrono::steady_clock;
+
+  atomic<int64_t> m_full_at{0};
+  int64_t m_interval;
+  int64_t m_tolerance;
+
+public:
+  token_bucket_sampler(double per_second, uint32_t burst) noexcept
+      : m_interval(static_cast<int64_t>(
+            chrono::duration_cast<clock::duration>(
+                chrono::duration<double>(1.0 / per_second))
+                .count())),
+        m_tolerance(m_interval * (burst ? burst : 1)) {}
+
+  bool sample() noexcept {
+    const int64_t now = clock::now().time_since_epoch().count();
+    int64_t full_at = m_full_at.load(memory_order_relaxed);
+    for (;;) {
+      const int64_t next = max(full_at, now) + m_interval;
+      if (next - now > m_tolerance) {
+        return false;
+      }
+      if (m_full_at.compare_exchange_weak(full_at, next,
+                                          memory_order_relaxed)) {
+        return true;
+      }
+    }
+  }
+};
+
+// An error that carries a backtrace of where it was created, if it was
+// sampled.
+template <class E> class traced_error {
+  E m_error;
+  shared_ptr<const backtrace_frames> m_trace;
+
+public:
+  using error_type = E;
+
+  template <class... Args,
+            enable_if_t<is_constructible_v<E, Args...>> * = nullptr>
+  explicit traced_error(shared_ptr<const backtrace_frames> trace,
+                        Args &&... args)
+      : m_error(forward<Args>(args)...), m_trace(move(trace)) {}
+  template <class G, enable_if_t<!is_same_v<G, E> &&
+                                 is_convertible_v<const G &, E>> * = nullptr>
+  traced_error(const traced_error<G> &other)
+      : traced_error(other.backtrace(), other.error()) {}
+  template <class G,
+            enable_if_t<!is_same_v<G, E> && is_convertible_v<G, E>> * = nullptr>
+  traced_error(traced_error<G> &&other)
+      : traced_error(other.backtrace(), move(other).error()) {}
+
+  const E &error() const & noexcept { return m_error; }
+  E &error() & noexcept { return m_error; }
+  E &&error() && noexcept { return move(m_error); }
+
+  // Null unless this error was sampled.
+  const shared_ptr<const backtrace_frames> &backtrace() const noexcept {
+    return m_trace;
+  }
+};
+
+template <class E>
+bool operator==(const traced_error<E> &x, const traced_error<E> &y) {
+  return x.error() == y.error();
+}
+template <class E>
+bool operator!=(const traced_error<E> &x, const traced_error<E> &y) {
+  return !(x == y);
+}
+
+template <class Sampler, class E>
+unexpected<traced_error<decay_t<E>>> make_traced_unexpected(Sampler &sampler,
+                                                            E &&error) {
+  return unexpected<traced_error<decay_t<E>>>(
+      in_place, sampler.sample() ? backtrace_frames::capture(1) : nullptr,
+      forward<E>(error));
+}
+
+} // namespace fundamentals_v3
+} // namespace std::experimental
+
+// EXPECTED_TRACED_UNEXPECTED(sampler, e) is unexpected(traced_error(e)) with
+// a backtrace when the sampler, one per call site, selects it; for example
+// EXPECTED_TRACED_UNEXPECTED(one_in_sampler(1000), errc::io_error).
+#define EXPECTED_TRACED_UNEXPECTED(sampler, error)                             \
+  (::std::experimental::make_traced_unexpected(                                \
+      []() -> auto & {                                                         \
+        using namespace ::std::experimental;                                   \
+        static auto site_sampler = sampler;                                    \
+        return site_sampler;                                                   \
+      }(),                                                                     \
+      error))
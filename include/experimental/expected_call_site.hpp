@@ -0,0 +1,197 @@
+// SPDX-License-Identifier: CC0-1.0
+///
+// expected - An c++17 implementation of std::expected with extensions
+//
+// To the extent possible under law, the author(s) have dedicated all
+// copyright and related and neighboring rights to this software to the
+// public domain worldwide. This software is distributed without any warranty.
+//
+// You should have received a copy of the CC0 Public Domain Dedication
+// along with this software. If not, see
+// <http://creativecommons.org/publicdomain/zero/1.0/>.
+///
+
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <experimental/expected.hpp>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <tuple>
+
+// Define EXPECTED_CALL_SITES to 1 to record where located errors are created.
+// Otherwise located_error<E> is laid out exactly like E and
+// EXPECTED_UNEXPECTED does no more than build the unexpected. The setting may
+// differ between translation units: located_error<E> names a different type
+// in each mode, so mixing them fails to link instead of breaking the ODR.
+#ifndef EXPECTED_CALL_SITES
+#define EXPECTED_CALL_SITES 0
+#endif
+
+namespace std::experimental {
+inline namespace fundamentals_v3 {
+
+struct call_site {
+  const char *file;
+  uint_least32_t line;
+  const char *function;
+};
+
+// Id 0 means the call site is unknown.
+using call_site_id = uint32_t;
+
+// The process wide table of call sites. Every site is interned once, the
+// first time it produces an error, and is known by its index from then on.
+// One source location can expand into several function local statics, one
+// per instantiation of a template for instance, so sites are deduplicated
+// by file, line and function name, compared by content since each
+// translation unit has its own copy of the literals.
+class call_site_registry {
+  using key = tuple<string_view, uint_least32_t, string_view>;
+
+  mutex m_mutex;
+  deque<call_site> m_sites;
+  map<key, call_site_id> m_ids;
+
+  static call_site_registry &instance() {
+    static call_site_registry registry;
+    return registry;
+  }
+
+public:
+  static call_site_id intern(const call_site &site) {
+    call_site_registry &r = instance();
+    lock_guard<mutex> lock(r.m_mutex);
+    auto [it, inserted] = r.m_ids.try_emplace(
+        key(site.file, site.line, site.function), call_site_id(0));
+    if (inserted) {
+      r.m_sites.push_back(site);
+      it->second = static_cast<call_site_id>(r.m_sites.size());
+    }
+    return it->second;
+  }
+
+  static optional<call_site> lookup(call_site_id id) {
+    call_site_registry &r = instance();
+    lock_guard<mutex> lock(r.m_mutex);
+    if (id == 0 || id > r.m_sites.size()) {
+      return nullopt;
+    }
+    return r.m_sites[id - 1];
+  }
+};
+
+// An error together with the id of the call site that created it, if Located.
+template <class E, bool Located> class basic_located_error {
+  E m_error;
+
+public:
+  using error_type = E;
+
+  template <class... Args,
+            enable_if_t<is_constructible_v<E, Args...>> * = nullptr>
+  constexpr explicit basic_located_error(call_site_id, Args &&... args)
+      : m_error(forward<Args>(args)...) {}
+  template <class G, enable_if_t<!is_same_v<G, E> &&
+                                 is_convertible_v<const G &, E>> * = nullptr>
+  constexpr basic_located_error(const basic_located_error<G, Located> &other)
+      : basic_located_error(other.site(), other.error()) {}
+  template <class G,
+            enable_if_t<!is_same_v<G, E> && is_convertible_v<G, E>> * = nullptr>
+  constexpr basic_located_error(basic_located_error<G, Located> &&other)
+      : basic_located_error(other.site(), move(other).error()) {}
+
+  constexpr const E &error() const & noexcept { return m_error; }
+  constexpr E &error() & noexcept { return m_error; }
+  constexpr E &&error() && noexcept { return move(m_error); }
+
+  constexpr call_site_id site() const noexcept { return 0; }
+
+  optional<call_site> location() const { return nullopt; }
+};
+
+template <class E> class basic_located_error<E, true> {
+  E m_error;
+  call_site_id m_site = 0;
+
+public:
+  using error_type = E;
+
+  template <class... Args,
+            enable_if_t<is_constructible_v<E, Args...>> * = nullptr>
+  constexpr explicit basic_located_error(call_site_id site, Args &&... args)
+      : m_error(forward<Args>(args)...), m_site(site) {}
+  template <class G, enable_if_t<!is_same_v<G, E> &&
+                                 is_convertible_v<const G &, E>> * = nullptr>
+  constexpr basic_located_error(const basic_located_error<G, true> &other)
+      : basic_located_error(other.site(), other.error()) {}
+  template <class G,
+            enable_if_t<!is_same_v<G, E> && is_convertible_v<G, E>> * = nullptr>
+  constexpr basic_located_error(basic_located_error<G, true> &&other)
+      : basic_located_error(other.site(), move(other).error()) {}
+
+  constexpr const E &error() const & noexcept { return m_error; }
+  constexpr E &error() & noexcept { return m_error; }
+  constexpr E &&error() && noexcept { return move(m_error); }
+
+  constexpr call_site_id site() const noexcept { return m_site; }
+
+  optional<call_site> location() const {
+    return call_site_registry::lookup(m_site);
+  }
+};
+
+template <class E, bool Located>
+constexpr bool operator==(const basic_located_error<E, Located> &x,
+                          const basic_located_error<E, Located> &y) {
+  return x.error() == y.error();
+}
+template <class E, bool Located>
+constexpr bool operator!=(const basic_located_error<E, Located> &x,
+                          const basic_located_error<E, Located> &y) {
+  return !(x == y);
+}
+
+// The names that depend on EXPECTED_CALL_SITES live in an inline namespace
+// per mode.
+#if EXPECTED_CALL_SITES
+inline namespace call_sites_enabled {
+#else
+inline namespace call_sites_disabled {
+#endif
+
+template <class E>
+using located_error = basic_located_error<E, EXPECTED_CALL_SITES != 0>;
+
+template <class E>
+constexpr unexpected<located_error<decay_t<E>>>
+make_located_unexpected(call_site_id site, E &&error) {
+  return unexpected<located_error<decay_t<E>>>(in_place, site,
+                                               forward<E>(error));
+}
+
+} // namespace call_sites_enabled / call_sites_disabled
+
+} // namespace fundamentals_v3
+} // namespace std::experimental
+
+// The id of the enclosing call site. Each expansion interns its site the
+// first time it runs and then only reads a function local static.
+#if EXPECTED_CALL_SITES
+#define EXPECTED_CALL_SITE()                                                   \
+  ([](const char *function) {                                                  \
+    static const ::std::experimental::call_site_id id =                        \
+        ::std::experimental::call_site_registry::intern(                       \
+            {__FILE__, __LINE__, function});                                   \
+    return id;                                                                 \
+  }(__func__))
+#else
+#define EXPECTED_CALL_SITE() (::std::experimental::call_site_id(0))
+#endif
+
+// EXPECTED_UNEXPECTED(e) is unexpected(located_error(e)) tagged with the
+// current call site.
+#define EXPECTED_UNEXPECTED(error)                                             \
+  (::std::experimental::make_located_unexpected(EXPECTED_CALL_SITE(), error))
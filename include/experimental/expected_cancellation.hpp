@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: CC0-1.0
+///
+// expected - An c++17 implementation of std::expected with extensions
+//
+// To the extent possible under law, the author(s) have dedicated all
+// copyright and related and neighboring rights to this software to the
+// public domain worldwide. This software is distributed without any warranty.
+//
+// You should have received a copy of the CC0 Public Domain Dedication
+// along with this software. If not, see
+// <http://creativecommons.org/publicdomain/zero/1.0/>.
+///
+
+#pragma once
+#include <atomic>
+#include <experimental/expected.hpp>
+#include <memory>
+
+namespace std::experimental {
+inline namespace fundamentals_v3 {
+
+class cancellation_token;
+
+namespace detail {
+struct cancellation_access;
+}
+
+// Owns a cancellation flag. Tokens handed out by token() observe it and stay
+// valid after the source is gone.
+class cancellation_source {
+  shared_ptr<atomic<bool>> m_flag = make_shared<atomic<bool>>(false);
+
+public:
+  // Returns true for the call that actually requested cancellation.
+  bool request_cancellation() noexcept {
+    return !m_flag->exchange(true, memory_order_acq_rel);
+  }
+  bool is_cancellation_requested() const noexcept {
+    return m_flag->load(memory_order_acquire);
+  }
+
+  cancellation_token token() const noexcept;
+};
+
+// A cheap, copyable view of a cancellation_source. A default constructed
+// token can never be cancelled.
+class cancellation_token {
+  shared_ptr<const atomic<bool>> m_flag;
+
+  friend class cancellation_source;
+  friend struct detail::cancellation_access;
+  explicit cancellation_token(shared_ptr<const atomic<bool>> flag) noexcept
+      : m_flag(move(flag)) {}
+
+public:
+  cancellation_token() noexcept = default;
+
+  bool can_be_cancelled() const noexcept { return m_flag != nullptr; }
+  bool is_cancellation_requested() const noexcept {
+    return m_flag && m_flag->load(memory_order_acquire);
+  }
+};
+
+inline cancellation_token cancellation_source::token() const noexcept {
+  return cancellation_token(m_flag);
+}
+
+namespace detail {
+
+struct cancellation_access {
+  static const atomic<bool> *flag(const cancellation_token &token) noexcept {
+    return token.m_flag.get();
+  }
+};
+
+template <class Exp, class G>
+remove_cvref_t<Exp> cancellable_and_then_impl(Exp &&exp, const atomic<bool> *,
+                                              G &) {
+  return forward<Exp>(exp);
+}
+
+// Calls f on the value of exp, which the caller has already checked. Going
+// through and_then would test has_value() again after the atomic load, where
+// the compiler can no longer prove the error branch dead.
+template <class Exp, class F> auto cancellable_stage(Exp &&exp, F &&f) {
+  if constexpr (is_void_v<typename remove_cvref_t<Exp>::value_type>) {
+    return invoke(forward<F>(f));
+  } else {
+    return invoke(forward<F>(f), *forward<Exp>(exp));
+  }
+}
+
+template <class Exp, class G, class F, class... Fs>
+auto cancellable_and_then_impl(Exp &&exp, const atomic<bool> *flag,
+                               G &cancelled, F &&f, Fs &&... fs) {
+  using Next = decltype(cancellable_stage(forward<Exp>(exp), forward<F>(f)));
+  using Ret = decltype(cancellable_and_then_impl(
+      declval<Next>(), flag, cancelled, forward<Fs>(fs)...));
+  static_assert(is_expected_v<Next>, "F must return an expected");
+  if (!exp.has_value()) {
+    return Ret(unexpect, forward<Exp>(exp).error());
+  }
+  if (flag && flag->load(memory_order_relaxed)) {
+    return Ret(unexpect, cancelled);
+  }
+  return cancellable_and_then_impl(
+      cancellable_stage(forward<Exp>(exp), forward<F>(f)), flag, cancelled,
+      forward<Fs>(fs)...);
+}
+
+} // namespace detail
+
+// exp.and_then(f).and_then(fs)..., except that before each stage the token is
+// checked with one relaxed load. Once cancellation is requested the chain
+// stops with the cancelled error and the remaining callables are not invoked.
+template <class Exp, class G, class... Fs,
+          enable_if_t<detail::is_expected_v<detail::remove_cvref_t<Exp>>> * =
+              nullptr>
+auto cancellable_and_then(Exp &&exp, const cancellation_token &token,
+                          G cancelled, Fs &&... fs) {
+  return detail::cancellable_and_then_impl(
+      forward<Exp>(exp), detail::cancellation_access::flag(token), cancelled,
+      forward<Fs>(fs)...);
+}
+
+} // namespace fundamentals_v3
+} // namespace std::experimental
@@ -0,0 +1,268 @@
+// SPDX-License-Identifier: CC0-1.0
+///
+// expected - An c++17 implementation of std::expected with extensions
+//
+// To the extent possible under law, the author(s) have dedicated all
+// copyright and related and neighboring rights to this software to the
+// public domain worldwide. This software is distributed without any warranty.
+//
+// You should have received a copy of the CC0 Public Domain Dedication
+// along with this software. If not, see
+// <http://creativecommons.org/publicdomain/zero/1.0/>.
+///
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <experimental/expected.hpp>
+#include <iterator>
+#include <new>
+#include <string>
+#include <string_view>
+
+namespace std::experimental {
+inline namespace fundamentals_v3 {
+
+// A bump allocator for error context. Memory is only returned by reset(),
+// which keeps the first block and releases any others; with a block size that
+// covers a typical request, a reset is a single pointer store. Not thread
+// safe: use one arena per request or per thread.
+class error_arena {
+  struct block {
+    block *m_next;
+    size_t m_size;
+  };
+
+  size_t m_block_size;
+  block *m_blocks = nullptr;
+  unsigned char *m_cursor = nullptr;
+  unsigned char *m_end = nullptr;
+
+  static unsigned char *data(block *b) noexcept {
+    return reinterpret_cast<unsigned char *>(b + 1);
+  }
+
+  void *grow(size_t size, size_t align) {
+    const size_t bytes = max(m_block_size, size + align);
+    block *b = static_cast<block *>(::operator new(sizeof(block) + bytes));
+    b->m_size = bytes;
+    // The newest block goes second, so the first one is the one reset keeps.
+    if (m_blocks) {
+      b->m_next = m_blocks->m_next;
+      m_blocks->m_next = b;
+    } else {
+      b->m_next = nullptr;
+      m_blocks = b;
+    }
+    m_cursor = data(b);
+    m_end = m_cursor + bytes;
+    return allocate(size, align);
+  }
+
+  static error_arena *&scoped() noexcept {
+    static thread_local error_arena *arena = nullptr;
+    return arena;
+  }
+
+public:
+  explicit error_arena(size_t block_size = 4096) noexcept
+      : m_block_size(block_size) {}
+  error_arena(const error_arena &) = delete;
+  error_arena &operator=(const error_arena &) = delete;
+  ~error_arena() {
+    while (m_blocks) {
+      ::operator delete(exchange(m_blocks, m_blocks->m_next));
+    }
+  }
+
+  void *allocate(size_t size, size_t align) {
+    const auto p = reinterpret_cast<uintptr_t>(m_cursor);
+    const uintptr_t aligned = (p + align - 1) & ~uintptr_t(align - 1);
+    if (!m_cursor || aligned + size > reinterpret_cast<uintptr_t>(m_end)) {
+      return grow(size, align);
+    }
+    m_cursor = reinterpret_cast<unsigned char *>(aligned + size);
+    return m_cursor - size;
+  }
+
+  // Frees everything allocated from the arena at once; errors that still
+  // refer to it must not be used afterwards.
+  void reset() noexcept {
+    if (!m_blocks) {
+      return;
+    }
+    while (block *extra = m_blocks->m_next) {
+      m_blocks->m_next = extra->m_next;
+      ::operator delete(extra);
+    }
+    m_cursor = data(m_blocks);
+    m_end = m_cursor + m_blocks->m_size;
+  }
+
+  // The arena of the innermost scope on this thread, or else the thread's own
+  // arena.
+  static error_arena &current() {
+    if (error_arena *arena = scoped()) {
+      return *arena;
+    }
+    static thread_local error_arena local;
+    return local;
+  }
+
+  // Makes an arena current for the lifetime of the scope.
+  class scope {
+    error_arena *m_prev;
+
+  public:
+    explicit scope(error_arena &arena) noexcept
+        : m_prev(exchange(scoped(), &arena)) {}
+    scope(const scope &) = delete;
+    scope &operator=(const scope &) = delete;
+    ~scope() { scoped() = m_prev; }
+  };
+};
+
+namespace detail {
+
+struct context_frame {
+  const context_frame *m_next;
+  size_t m_size;
+
+  string_view text() const noexcept {
+    return string_view(reinterpret_cast<const char *>(this + 1), m_size);
+  }
+};
+
+} // namespace detail
+
+// An error plus a chain of context strings ("while reading X", "for tenant
+// Y"), outermost first. Adding context copies the text into an error_arena
+// and links it in front of the chain, so it costs a bump allocation and the
+// chain is freed with the arena. Copies of the error share the chain.
+template <class E> class context_error {
+  E m_error;
+  const detail::context_frame *m_context = nullptr;
+
+  void push(string_view text, error_arena &arena) {
+    void *p = arena.allocate(sizeof(detail::context_frame) + text.size(),
+                             alignof(detail::context_frame));
+    auto *frame = new (p) detail::context_frame{m_context, text.size()};
+    memcpy(frame + 1, text.data(), text.size());
+    m_context = frame;
+  }
+
+public:
+  using error_type = E;
+
+  class iterator {
+    const detail::context_frame *m_frame = nullptr;
+
+  public:
+    using iterator_category = forward_iterator_tag;
+    using value_type = string_view;
+    using difference_type = ptrdiff_t;
+    using pointer = const string_view *;
+    using reference = string_view;
+
+    iterator() = default;
+    explicit iterator(const detail::context_frame *frame) noexcept
+        : m_frame(frame) {}
+
+    string_view operator*() const noexcept { return m_frame->text(); }
+    iterator &operator++() noexcept {
+      m_frame = m_frame->m_next;
+      return *this;
+    }
+    iterator operator++(int) noexcept {
+      iterator it = *this;
+      ++*this;
+      return it;
+    }
+    friend bool operator==(iterator x, iterator y) noexcept {
+      return x.m_frame == y.m_frame;
+    }
+    friend bool operator!=(iterator x, iterator y) noexcept {
+      return x.m_frame != y.m_frame;
+    }
+  };
+
+  struct context_range {
+    const detail::context_frame *m_first;
+
+    iterator begin() const noexcept { return iterator(m_first); }
+    iterator end() const noexcept { return iterator(); }
+    bool empty() const noexcept { return !m_first; }
+  };
+
+  explicit context_error(E error) : m_error(move(error)) {}
+  context_error(E error, string_view context,
+                error_arena &arena = error_arena::current())
+      : m_error(move(error)) {
+    push(context, arena);
+  }
+
+  const E &error() const & noexcept { return m_error; }
+  E &error() & noexcept { return m_error; }
+  E &&error() && noexcept { return move(m_error); }
+
+  context_error
+  with_context(string_view text,
+               error_arena &arena = error_arena::current()) const & {
+    context_error e(*this);
+    e.push(text, arena);
+    return e;
+  }
+  context_error &&
+  with_context(string_view text,
+               error_arena &arena = error_arena::current()) && {
+    push(text, arena);
+    return move(*this);
+  }
+
+  context_range context() const noexcept { return {m_context}; }
+
+  // The context joined by ": ", outermost first.
+  string context_string() const {
+    string out;
+    for (string_view text : context()) {
+      if (!out.empty()) {
+        out += ": ";
+      }
+      out += text;
+    }
+    return out;
+  }
+};
+
+namespace detail {
+
+class context_adder {
+  string_view m_text;
+  error_arena *m_arena;
+
+public:
+  context_adder(string_view text, error_arena *arena) noexcept
+      : m_text(text), m_arena(arena) {}
+
+  template <class E>
+  context_error<E> operator()(context_error<E> error) const {
+    return move(error).with_context(
+        m_text, m_arena ? *m_arena : error_arena::current());
+  }
+};
+
+} // namespace detail
+
+// For map_error: adds text to the context of a context_error. The text is
+// copied when the adder runs.
+inline detail::context_adder add_context(string_view text) noexcept {
+  return detail::context_adder(text, nullptr);
+}
+inline detail::context_adder add_context(string_view text,
+                                         error_arena &arena) noexcept {
+  return detail::context_adder(text, &arena);
+}
+
+} // namespace fundamentals_v3
+} // namespace std::experimental
@@ -0,0 +1,267 @@
+// SPDX-License-Identifier: CC0-1.0
+///
+// expected - An c++17 implementation of std::expected with extensions
+//
+// To the extent possible under law, the author(s) have dedicated all
+// copyright and related and neighboring rights to this software to the
+// public domain worldwide. This software is distributed without any warranty.
+//
+// You should have received a copy of the CC0 Public Domain Dedication
+// along with this software. If not, see
+// <http://creativecommons.org/publicdomain/zero/1.0/>.
+///
+
+#pragma once
+#include <experimental/expected.hpp>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define EXPECTED_HAS_COROUTINES 1
+// expected_coroutine_result relies on get_return_object being converted to
+// the return type only after the coroutine first suspends or returns. Older
+// Clang converts it before the body runs.
+#if defined(__clang__) &&                                                      \
+    ((defined(__apple_build_version__) && __clang_major__ < 15) ||            \
+     (!defined(__apple_build_version__) && __clang_major__ < 16))
+#error "expected coroutines need Clang 16 or later (Apple Clang 15 or later)"
+#endif
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <new>
+#include <optional>
+
+namespace std::experimental {
+inline namespace fundamentals_v3 {
+
+namespace detail {
+
+// Every frame ends with a pointer to the function that frees it, so the
+// default operator new and the allocator_arg_t overloads share one delete.
+struct coroutine_frame_trailer {
+  void (*m_free)(void *frame, size_t size) noexcept;
+};
+
+constexpr size_t coroutine_trailer_offset(size_t size) noexcept {
+  constexpr size_t align = alignof(coroutine_frame_trailer);
+  return (size + align - 1) & ~(align - 1);
+}
+
+inline coroutine_frame_trailer &coroutine_trailer(void *frame,
+                                                  size_t size) noexcept {
+  return *reinterpret_cast<coroutine_frame_trailer *>(
+      static_cast<unsigned char *>(frame) + coroutine_trailer_offset(size));
+}
+
+struct coroutine_frame_allocation {
+  static void *operator new(size_t size) {
+    void *frame = ::operator new(coroutine_trailer_offset(size) +
+                                 sizeof(coroutine_frame_trailer));
+    coroutine_trailer(frame, size).m_free = [](void *p, size_t) noexcept {
+      ::operator delete(p);
+    };
+    return frame;
+  }
+
+  // Frames of coroutines that take allocator_arg_t followed by an allocator,
+  // either first or right after the object parameter of a member function.
+  template <class Alloc, class... Args>
+  static void *operator new(size_t size, allocator_arg_t, const Alloc &alloc,
+                            Args &...) {
+    return allocate(size, alloc);
+  }
+  template <class Self, class Alloc, class... Args>
+  static void *operator new(size_t size, Self &, allocator_arg_t,
+                            const Alloc &alloc, Args &...) {
+    return allocate(size, alloc);
+  }
+
+  static void operator delete(void *frame, size_t size) noexcept {
+    coroutine_trailer(frame, size).m_free(frame, size);
+  }
+
+private:
+  struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) block {
+    unsigned char bytes[__STDCPP_DEFAULT_NEW_ALIGNMENT__];
+  };
+
+  template <class Alloc>
+  using block_allocator =
+      typename allocator_traits<Alloc>::template rebind_alloc<block>;
+
+  // The frame is followed by the trailer and then a copy of the allocator.
+  template <class Alloc>
+  static constexpr size_t allocator_offset(size_t size) noexcept {
+    constexpr size_t align = alignof(block_allocator<Alloc>);
+    const size_t end =
+        coroutine_trailer_offset(size) + sizeof(coroutine_frame_trailer);
+    return (end + align - 1) & ~(align - 1);
+  }
+  template <class Alloc>
+  static constexpr size_t allocation_blocks(size_t size) noexcept {
+    const size_t bytes =
+        allocator_offset<Alloc>(size) + sizeof(block_allocator<Alloc>);
+    return (bytes + sizeof(block) - 1) / sizeof(block);
+  }
+
+  template <class Alloc>
+  static void *allocate(size_t size, const Alloc &alloc) {
+    using traits = allocator_traits<block_allocator<Alloc>>;
+    block_allocator<Alloc> a(alloc);
+    void *frame = traits::allocate(a, allocation_blocks<Alloc>(size));
+    new (static_cast<unsigned char *>(frame) + allocator_offset<Alloc>(size))
+        block_allocator<Alloc>(move(a));
+    coroutine_trailer(frame, size).m_free = &deallocate<Alloc>;
+    return frame;
+  }
+
+  template <class Alloc>
+  static void deallocate(void *frame, size_t size) noexcept {
+    using traits = allocator_traits<block_allocator<Alloc>>;
+    auto *stored = launder(reinterpret_cast<block_allocator<Alloc> *>(
+        static_cast<unsigned char *>(frame) + allocator_offset<Alloc>(size)));
+    block_allocator<Alloc> a(move(*stored));
+    stored->~block_allocator<Alloc>();
+    traits::deallocate(a, static_cast<block *>(frame),
+                       allocation_blocks<Alloc>(size));
+  }
+};
+
+template <class T, class E> class expected_promise_base;
+template <class T, class E> class expected_promise_type;
+
+// What get_return_object hands back. It can be neither copied nor moved, so
+// the compiler builds it in place and converts it to expected<T, E> only once
+// the coroutine has returned or stopped on an error. The frame is destroyed
+// here rather than at final suspend, so its whole lifetime is visible in the
+// caller and compilers that elide coroutine allocations can do so.
+template <class T, class E> class expected_coroutine_result {
+  coroutine_handle<expected_promise_type<T, E>> m_handle;
+  optional<expected<T, E>> m_result;
+
+  friend class expected_promise_base<T, E>;
+
+public:
+  explicit expected_coroutine_result(expected_promise_type<T, E> &promise)
+      : m_handle(coroutine_handle<expected_promise_type<T, E>>::from_promise(
+            promise)) {
+    promise.m_return = this;
+  }
+  expected_coroutine_result(const expected_coroutine_result &) = delete;
+  expected_coroutine_result &
+  operator=(const expected_coroutine_result &) = delete;
+
+  operator expected<T, E>() {
+    // Empty only if the conversion ran before the body did.
+    if (!m_result) {
+      terminate();
+    }
+    m_handle.destroy();
+    return move(*m_result);
+  }
+};
+
+template <class Exp> class expected_awaiter {
+  Exp &&m_exp;
+
+public:
+  explicit expected_awaiter(Exp &&exp) noexcept : m_exp(forward<Exp>(exp)) {}
+
+  bool await_ready() const noexcept { return m_exp.has_value(); }
+  template <class Promise>
+  void await_suspend(coroutine_handle<Promise> handle) {
+    handle.promise().return_error(forward<Exp>(m_exp).error());
+  }
+  decltype(auto) await_resume() const noexcept {
+    if constexpr (!is_void_v<typename remove_cvref_t<Exp>::value_type>) {
+      return *forward<Exp>(m_exp);
+    }
+  }
+};
+
+template <class G> class unexpected_awaiter {
+  unexpected<G> &&m_unex;
+
+public:
+  explicit unexpected_awaiter(unexpected<G> &&unex) noexcept
+      : m_unex(move(unex)) {}
+
+  bool await_ready() const noexcept { return false; }
+  template <class Promise>
+  void await_suspend(coroutine_handle<Promise> handle) {
+    handle.promise().return_error(move(m_unex).value());
+  }
+  void await_resume() const noexcept {}
+};
+
+template <class T, class E>
+class expected_promise_base : public coroutine_frame_allocation {
+protected:
+  expected_coroutine_result<T, E> *m_return = nullptr;
+
+  template <class... Args> void set_result(Args &&... args) {
+    m_return->m_result.emplace(forward<Args>(args)...);
+  }
+
+  friend class expected_coroutine_result<T, E>;
+
+public:
+  expected_coroutine_result<T, E> get_return_object() noexcept {
+    return expected_coroutine_result<T, E>(
+        static_cast<expected_promise_type<T, E> &>(*this));
+  }
+  suspend_never initial_suspend() const noexcept { return {}; }
+  suspend_always final_suspend() const noexcept { return {}; }
+  // The exception propagates out of the call; the frame is freed as it
+  // unwinds.
+  void unhandled_exception() const { throw; }
+
+  template <class G> void return_error(G &&error) {
+    set_result(unexpect, forward<G>(error));
+  }
+
+  // co_await unwraps the value of any expected whose error converts to E, or
+  // stops the coroutine with that error.
+  template <class Exp,
+            enable_if_t<is_expected_v<remove_cvref_t<Exp>>> * = nullptr>
+  expected_awaiter<Exp> await_transform(Exp &&exp) const noexcept {
+    return expected_awaiter<Exp>(forward<Exp>(exp));
+  }
+  // co_await unexpected(e) stops the coroutine with e, which also works in
+  // coroutines that return expected<void, E>.
+  template <class G>
+  unexpected_awaiter<G> await_transform(unexpected<G> &&unex) const noexcept {
+    return unexpected_awaiter<G>(move(unex));
+  }
+};
+
+template <class T, class E>
+class expected_promise_type : public expected_promise_base<T, E> {
+public:
+  template <class U = T> void return_value(U &&value) {
+    this->set_result(forward<U>(value));
+  }
+};
+
+template <class E>
+class expected_promise_type<void, E> : public expected_promise_base<void, E> {
+public:
+  void return_void() { this->set_result(); }
+};
+
+} // namespace detail
+
+} // namespace fundamentals_v3
+} // namespace std::experimental
+
+// A function returning expected<T, E> may be a coroutine. co_await on an
+// expected yields its value or returns its error straight away; co_return
+// takes anything expected<T, E> can be constructed from. Frames come from
+// operator new unless the function takes (std::allocator_arg_t, Alloc) first.
+// Compilers must convert the result of get_return_object lazily (GCC, MSVC,
+// Clang 16+); older Clang is rejected above.
+template <class T, class E, class... Args>
+struct std::coroutine_traits<std::experimental::expected<T, E>, Args...> {
+  using promise_type = std::experimental::detail::expected_promise_type<T, E>;
+};
+
+#endif
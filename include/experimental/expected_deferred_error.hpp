@@ -0,0 +1,357 @@
+// SPDX-License-Identifier: CC0-1.0
+///
+// expected - An c++17 implementation of std::expected with extensions
+//
+// To the extent possible under law, the author(s) have dedicated all
+// copyright and related and neighboring rights to this software to the
+// public domain worldwide. This software is distributed without any warranty.
+//
+// You should have received a copy of the CC0 Public Domain Dedication
+// along with this software. If not, see
+// <http://creativecommons.org/publicdomain/zero/1.0/>.
+///
+
+#pragma once
+#include <cstdio>
+#include <cstring>
+#include <experimental/expected.hpp>
+#include <string>
+#include <string_view>
+#include <tuple>
+
+namespace std::experimental {
+inline namespace fundamentals_v3 {
+
+namespace detail {
+
+enum class deferred_arg : unsigned char {
+  signed_integer,
+  unsigned_integer,
+  floating_point,
+  character,
+  boolean,
+  string
+};
+
+inline constexpr size_t deferred_max_args = 16;
+
+struct deferred_value {
+  deferred_arg m_kind;
+  union {
+    long long m_signed;
+    unsigned long long m_unsigned;
+    double m_double;
+    char m_char;
+    bool m_bool;
+  };
+  string_view m_string;
+};
+
+template <class> inline constexpr bool deferred_unsupported = false;
+
+template <class... Args> class deferred_context;
+
+} // namespace detail
+
+// An error code plus a message that is only formatted when asked for. Each
+// message layer is a pointer to a format string with "{}" placeholders and a
+// copy of its arguments, packed into an inline buffer of Capacity bytes, so
+// building the error never allocates. The format string is not copied, so it
+// must be a string literal; mutable char arrays are rejected. Arguments may be
+// integers, enums, floating point numbers, chars, bools and strings; strings
+// are copied whole. Layers added with with_context() render outermost first,
+// joined by ": ". A layer that does not fit is dropped and shows as "..." in
+// its place; consecutive dropped layers show as one.
+template <class Code, size_t Capacity = 64> class deferred_error {
+  static_assert(Capacity < 65536, "Capacity must fit in 16 bits");
+
+  // A layer takes at least its format pointer; a dropped one is recorded
+  // as a null pointer.
+  static constexpr size_t max_layers = Capacity / sizeof(const char *);
+  using layer_count =
+      conditional_t<(max_layers < 256), unsigned char, unsigned short>;
+
+  // Whether the latest layer was dropped, and if so whether a marker for it
+  // is in the buffer or, when even that did not fit, it is only remembered
+  // here to be shown outermost.
+  enum class tail : unsigned char { kept, marked, dropped };
+
+  Code m_code;
+  unsigned short m_size = 0;
+  layer_count m_layers = 0;
+  tail m_tail = tail::kept;
+  unsigned char m_bytes[Capacity];
+
+  template <class... Args> friend class detail::deferred_context;
+
+  bool put(const void *data, size_t size) noexcept {
+    if (Capacity - m_size < size) {
+      return false;
+    }
+    memcpy(m_bytes + m_size, data, size);
+    m_size += static_cast<unsigned short>(size);
+    return true;
+  }
+
+  template <class T> bool put(detail::deferred_arg kind, T value) noexcept {
+    return put(&kind, 1) && put(&value, sizeof(value));
+  }
+
+  template <class A> bool put_arg(const A &arg) noexcept {
+    using detail::deferred_arg;
+    if constexpr (is_same_v<A, bool>) {
+      return put(deferred_arg::boolean, arg);
+    } else if constexpr (is_same_v<A, char>) {
+      return put(deferred_arg::character, arg);
+    } else if constexpr (is_enum_v<A>) {
+      return put_arg(static_cast<underlying_type_t<A>>(arg));
+    } else if constexpr (is_integral_v<A> && is_signed_v<A>) {
+      return put(deferred_arg::signed_integer, static_cast<long long>(arg));
+    } else if constexpr (is_integral_v<A>) {
+      return put(deferred_arg::unsigned_integer,
+                 static_cast<unsigned long long>(arg));
+    } else if constexpr (is_floating_point_v<A>) {
+      return put(deferred_arg::floating_point, static_cast<double>(arg));
+    } else if constexpr (is_convertible_v<const A &, string_view>) {
+      // A longer string could not fit anyway, since Capacity < 65536.
+      const string_view s = arg;
+      if (s.size() >= Capacity) {
+        return false;
+      }
+      const auto size = static_cast<unsigned short>(s.size());
+      return put(deferred_arg::string, size) && put(s.data(), size);
+    } else {
+      static_assert(detail::deferred_unsupported<A>,
+                    "unsupported deferred_error argument type");
+      return false;
+    }
+  }
+
+  template <class... Args>
+  void push(const char *format, const Args &... args) noexcept {
+    static_assert(sizeof...(Args) <= detail::deferred_max_args,
+                  "too many deferred_error arguments");
+    const unsigned short mark = m_size;
+    const auto count = static_cast<unsigned char>(sizeof...(Args));
+    if (put(&format, sizeof(format)) && put(&count, 1) &&
+        (put_arg(args) && ...)) {
+      ++m_layers;
+      m_tail = tail::kept;
+      return;
+    }
+    m_size = mark;
+    if (m_tail == tail::kept) {
+      const char *const marker = nullptr;
+      if (put(&marker, sizeof(marker))) {
+        ++m_layers;
+        m_tail = tail::marked;
+      } else {
+        m_tail = tail::dropped;
+      }
+    }
+  }
+
+  template <class T> T get(size_t &offset) const noexcept {
+    T value;
+    memcpy(&value, m_bytes + offset, sizeof(value));
+    offset += sizeof(value);
+    return value;
+  }
+
+  // snprintf rather than to_chars, which lacks floating point before
+  // libstdc++ 11.
+  static void append(string &out, const detail::deferred_value &v) {
+    using detail::deferred_arg;
+    char buffer[32];
+    int n = 0;
+    switch (v.m_kind) {
+    case deferred_arg::signed_integer:
+      n = snprintf(buffer, sizeof(buffer), "%lld", v.m_signed);
+      break;
+    case deferred_arg::unsigned_integer:
+      n = snprintf(buffer, sizeof(buffer), "%llu", v.m_unsigned);
+      break;
+    case deferred_arg::floating_point:
+      n = snprintf(buffer, sizeof(buffer), "%g", v.m_double);
+      break;
+    case deferred_arg::character:
+      out += v.m_char;
+      return;
+    case deferred_arg::boolean:
+      out += v.m_bool ? "true" : "false";
+      return;
+    case deferred_arg::string:
+      out += v.m_string;
+      return;
+    }
+    if (n > 0) {
+      out.append(buffer, static_cast<size_t>(n));
+    }
+  }
+
+  // Reads the layer at offset and returns the offset of the next one. A
+  // dropped layer has a null format.
+  size_t decode(size_t offset, const char *&format, size_t &count,
+                detail::deferred_value *values) const noexcept {
+    using detail::deferred_arg;
+    format = get<const char *>(offset);
+    if (!format) {
+      count = 0;
+      return offset;
+    }
+    count = get<unsigned char>(offset);
+    for (size_t i = 0; i < count; ++i) {
+      detail::deferred_value &v = values[i];
+      v.m_kind = get<deferred_arg>(offset);
+      switch (v.m_kind) {
+      case deferred_arg::signed_integer:
+        v.m_signed = get<long long>(offset);
+        break;
+      case deferred_arg::unsigned_integer:
+        v.m_unsigned = get<unsigned long long>(offset);
+        break;
+      case deferred_arg::floating_point:
+        v.m_double = get<double>(offset);
+        break;
+      case deferred_arg::character:
+        v.m_char = get<char>(offset);
+        break;
+      case deferred_arg::boolean:
+        v.m_bool = get<bool>(offset);
+        break;
+      case deferred_arg::string: {
+        const size_t size = get<unsigned short>(offset);
+        v.m_string = string_view(
+            reinterpret_cast<const char *>(m_bytes + offset), size);
+        offset += size;
+        break;
+      }
+      }
+    }
+    return offset;
+  }
+
+  static void render(string &out, const char *format, size_t count,
+                     const detail::deferred_value *values) {
+    if (!format) {
+      out += "...";
+      return;
+    }
+    size_t next = 0;
+    for (const char *p = format; *p; ++p) {
+      if ((p[0] == '{' && p[1] == '{') || (p[0] == '}' && p[1] == '}')) {
+        out += *p++;
+      } else if (p[0] == '{' && p[1] == '}' && next < count) {
+        append(out, values[next++]);
+        ++p;
+      } else {
+        out += *p;
+      }
+    }
+  }
+
+public:
+  using code_type = Code;
+
+  explicit deferred_error(Code code) noexcept : m_code(move(code)) {}
+  template <size_t N, class... Args>
+  deferred_error(Code code, const char (&format)[N],
+                 const Args &... args) noexcept
+      : m_code(move(code)) {
+    push(format, args...);
+  }
+  template <size_t N, class... Args>
+  deferred_error(Code code, char (&format)[N], const Args &... args) = delete;
+
+  const Code &code() const noexcept { return m_code; }
+
+  // Adds an outer layer, such as the operation that failed because of this
+  // error.
+  template <size_t N, class... Args>
+  deferred_error with_context(const char (&format)[N],
+                              const Args &... args) const &noexcept {
+    deferred_error e(*this);
+    e.push(format, args...);
+    return e;
+  }
+  template <size_t N, class... Args>
+  deferred_error &&with_context(const char (&format)[N],
+                                const Args &... args) &&noexcept {
+    push(format, args...);
+    return move(*this);
+  }
+  template <size_t N, class... Args>
+  deferred_error with_context(char (&format)[N], const Args &... args) const & =
+      delete;
+  template <size_t N, class... Args>
+  deferred_error &&with_context(char (&format)[N], const Args &... args) && =
+      delete;
+
+  string message() const {
+    size_t starts[max_layers + 1];
+    const char *format;
+    size_t count;
+    detail::deferred_value values[detail::deferred_max_args];
+    size_t offset = 0;
+    for (size_t i = 0; i < m_layers; ++i) {
+      starts[i] = offset;
+      offset = decode(offset, format, count, values);
+    }
+    string out = m_tail == tail::dropped ? "..." : "";
+    for (size_t i = m_layers; i-- > 0;) {
+      if (i + 1 < m_layers || m_tail == tail::dropped) {
+        out += ": ";
+      }
+      decode(starts[i], format, count, values);
+      render(out, format, count, values);
+    }
+    return out;
+  }
+};
+
+namespace detail {
+
+// Strings are held by view: the context is meant to be applied within the
+// full expression that made it, as map_error(error_context(...)) does, and
+// an error that needs it copies them into its own buffer.
+template <class A>
+using deferred_context_arg =
+    conditional_t<is_convertible_v<const decay_t<A> &, string_view>,
+                  string_view, decay_t<A>>;
+
+template <class... Args> class deferred_context {
+  const char *m_format;
+  tuple<Args...> m_args;
+
+public:
+  deferred_context(const char *format, Args... args)
+      : m_format(format), m_args(move(args)...) {}
+
+  template <class Code, size_t Capacity>
+  deferred_error<Code, Capacity>
+  operator()(deferred_error<Code, Capacity> error) const {
+    apply(
+        [&](const Args &... args) {
+          error.push(m_format, args...);
+        },
+        m_args);
+    return error;
+  }
+};
+
+} // namespace detail
+
+// For map_error: adds a context layer to a deferred_error as it passes up.
+// Nothing is copied or allocated unless there is an error; strings are
+// referred to, so the result must not outlive the arguments.
+template <size_t N, class... Args>
+detail::deferred_context<detail::deferred_context_arg<Args>...>
+error_context(const char (&format)[N], Args &&... args) {
+  return detail::deferred_context<detail::deferred_context_arg<Args>...>(
+      format, forward<Args>(args)...);
+}
+template <size_t N, class... Args>
+void error_context(char (&format)[N], Args &&... args) = delete;
+
+} // namespace fundamentals_v3
+} // namespace std::experimental
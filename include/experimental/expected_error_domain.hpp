@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: CC0-1.0
+///
+// expected - An c++17 implementation of std::expected with extensions
+//
+// To the extent possible under law, the author(s) have dedicated all
+// copyright and related and neighboring rights to this software to the
+// public domain worldwide. This software is distributed without any warranty.
+//
+// You should have received a copy of the CC0 Public Domain Dedication
+// along with this software. If not, see
+// <http://creativecommons.org/publicdomain/zero/1.0/>.
+///
+
+#pragma once
+#include <experimental/expected.hpp>
+#include <iterator>
+#include <string_view>
+
+namespace std::experimental {
+inline namespace fundamentals_v3 {
+
+struct error_entry {
+  string_view name;
+  string_view message;
+};
+
+// Specialize for an error enum whose enumerators run from 0 without gaps:
+//
+//   template <> struct error_domain<io_errc> {
+//     static constexpr string_view name = "io";
+//     static constexpr error_entry entries[] = {
+//         {"not_found", "no such file"}, {"denied", "permission denied"}};
+//   };
+//
+// The enum then serves as the error type directly, and names and messages are
+// looked up by indexing the table.
+template <class Enum> struct error_domain;
+
+// Specialize to convert From errors into To errors:
+//
+//   template <> struct error_domain_conversion<io_errc, app_errc> {
+//     static constexpr app_errc table[] = {app_errc::missing,
+//                                          app_errc::forbidden};
+//     static constexpr app_errc fallback = app_errc::internal;
+//   };
+//
+// table is indexed by From; values past its end map to fallback.
+template <class From, class To> struct error_domain_conversion;
+
+namespace detail {
+
+template <class Enum, class = void>
+struct is_error_domain_impl : false_type {};
+template <class Enum>
+struct is_error_domain_impl<
+    Enum, void_t<decltype(error_domain<Enum>::name),
+                 decltype(error_domain<Enum>::entries)>> : is_enum<Enum> {};
+
+template <class Enum> constexpr size_t error_index(Enum e) noexcept {
+  return static_cast<size_t>(static_cast<underlying_type_t<Enum>>(e));
+}
+
+template <class Enum>
+constexpr const error_entry *domain_entry(Enum e) noexcept {
+  constexpr auto &entries = error_domain<Enum>::entries;
+  const size_t i = error_index(e);
+  return i < size(entries) ? &entries[i] : nullptr;
+}
+
+} // namespace detail
+
+template <class Enum>
+inline constexpr bool is_error_domain_v =
+    detail::is_error_domain_impl<Enum>::value;
+
+template <class Enum, enable_if_t<is_error_domain_v<Enum>> * = nullptr>
+constexpr string_view domain_name() noexcept {
+  return error_domain<Enum>::name;
+}
+
+// Values outside the table are named "unknown".
+template <class Enum, enable_if_t<is_error_domain_v<Enum>> * = nullptr>
+constexpr string_view error_name(Enum e) noexcept {
+  const error_entry *entry = detail::domain_entry(e);
+  return entry ? entry->name : "unknown";
+}
+template <class Enum, enable_if_t<is_error_domain_v<Enum>> * = nullptr>
+constexpr string_view error_message(Enum e) noexcept {
+  const error_entry *entry = detail::domain_entry(e);
+  return entry ? entry->message : "unknown error";
+}
+template <class Enum, enable_if_t<is_error_domain_v<Enum>> * = nullptr>
+constexpr string_view error_message(const unexpected<Enum> &e) noexcept {
+  return error_message(e.value());
+}
+
+template <class To, class From,
+          enable_if_t<is_error_domain_v<From> && is_error_domain_v<To>> * =
+              nullptr>
+constexpr To convert_error(From e) noexcept {
+  using conversion = error_domain_conversion<From, To>;
+  constexpr auto &table = conversion::table;
+  const size_t i = detail::error_index(e);
+  return i < size(table) ? table[i] : conversion::fallback;
+}
+template <class To, class From,
+          enable_if_t<is_error_domain_v<From> && is_error_domain_v<To>> * =
+              nullptr>
+constexpr unexpected<To> convert_error(const unexpected<From> &e) noexcept {
+  return unexpected<To>(convert_error<To>(e.value()));
+}
+
+namespace detail {
+
+template <class To> struct domain_converter {
+  template <class From> constexpr To operator()(From e) const noexcept {
+    return convert_error<To>(e);
+  }
+};
+
+} // namespace detail
+
+// For map_error: r.map_error(to_domain<app_errc>).
+template <class To>
+inline constexpr detail::domain_converter<To> to_domain{};
+
+} // namespace fundamentals_v3
+} // namespace std::experimental
@@ -0,0 +1,279 @@
+// SPDX-License-Identifier: CC0-1.0
+///
+// expected - An c++17 implementation of std::expected with extensions
+//
+// To the extent possible under law, the author(s) have dedicated all
+// copyright and related and neighboring rights to this software to the
+// public domain worldwide. This software is distributed without any warranty.
+//
+// You should have received a copy of the CC0 Public Domain Dedication
+// along with this software. If not, see
+// <http://creativecommons.org/publicdomain/zero/1.0/>.
+///
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <experimental/expected.hpp>
+#include <new>
+#if __has_include(<version>)
+#include <version>
+#endif
+
+#if defined(__cpp_lib_atomic_wait)
+#define EXPECTED_WAIT_ATOMIC 1
+#elif defined(__linux__)
+#define EXPECTED_WAIT_FUTEX 1
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <thread>
+#endif
+
+namespace std::experimental {
+inline namespace fundamentals_v3 {
+
+namespace detail {
+
+// Blocks while word == old. Spurious wakeups are allowed; callers re-check.
+inline void atomic_wait(const atomic<uint32_t> &word, uint32_t old) noexcept {
+#if defined(EXPECTED_WAIT_ATOMIC)
+  word.wait(old, memory_order_acquire);
+#elif defined(EXPECTED_WAIT_FUTEX)
+  static_assert(sizeof(atomic<uint32_t>) == sizeof(uint32_t));
+  while (word.load(memory_order_acquire) == old) {
+    syscall(SYS_futex, reinterpret_cast<const uint32_t *>(&word),
+            FUTEX_WAIT_PRIVATE, old, nullptr, nullptr, 0);
+  }
+#else
+  while (word.load(memory_order_acquire) == old) {
+    this_thread::yield();
+  }
+#endif
+}
+
+inline void atomic_notify_all(atomic<uint32_t> &word) noexcept {
+#if defined(EXPECTED_WAIT_ATOMIC)
+  word.notify_all();
+#elif defined(EXPECTED_WAIT_FUTEX)
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE_PRIVATE,
+          INT32_MAX, nullptr, nullptr, 0);
+#else
+  (void)word;
+#endif
+}
+
+} // namespace detail
+
+template <class T, class E> class expected_promise;
+template <class T, class E> class expected_future;
+
+// The state shared by one promise and its future: the result, a state word to
+// wait on and a reference count. A caller that owns one can hand it to
+// expected_promise to avoid the heap; it must then outlive both ends.
+template <class T, class E> class expected_shared_state {
+  enum : uint32_t { pending, waiting, ready, broken };
+
+  atomic<uint32_t> m_state{pending};
+  atomic<uint32_t> m_refs{0};
+  bool m_owned = false;
+  union {
+    expected<T, E> m_result;
+  };
+
+  friend class expected_promise<T, E>;
+  friend class expected_future<T, E>;
+
+  void acquire() noexcept { m_refs.fetch_add(1, memory_order_relaxed); }
+  void release() noexcept {
+    if (m_refs.fetch_sub(1, memory_order_acq_rel) == 1) {
+      if (m_owned) {
+        delete this;
+      } else {
+        reset();
+      }
+    }
+  }
+  void reset() noexcept {
+    if (m_state.load(memory_order_relaxed) == ready) {
+      m_result.~expected();
+    }
+    m_state.store(pending, memory_order_relaxed);
+  }
+
+  void publish(uint32_t state) noexcept {
+    if (m_state.exchange(state, memory_order_acq_rel) == waiting) {
+      detail::atomic_notify_all(m_state);
+    }
+  }
+  template <class... Args> void set(Args &&... args) {
+    new (addressof(m_result)) expected<T, E>(forward<Args>(args)...);
+    publish(ready);
+  }
+  void abandon() noexcept { publish(broken); }
+
+  bool is_ready() const noexcept {
+    return m_state.load(memory_order_acquire) >= ready;
+  }
+  bool is_broken() const noexcept {
+    return m_state.load(memory_order_acquire) == broken;
+  }
+  void wait() noexcept {
+    uint32_t state = pending;
+    if (m_state.compare_exchange_strong(state, waiting,
+                                        memory_order_acquire) ||
+        state == waiting) {
+      detail::atomic_wait(m_state, waiting);
+    }
+  }
+
+public:
+  expected_shared_state() noexcept {}
+  expected_shared_state(const expected_shared_state &) = delete;
+  expected_shared_state &operator=(const expected_shared_state &) = delete;
+  ~expected_shared_state() { reset(); }
+};
+
+// The writing end of a one-shot channel. Errors travel as E inside the
+// expected; nothing is thrown or wrapped in an exception_ptr. A promise that
+// is destroyed without a result breaks the future instead: no E is made up,
+// so a broken promise cannot be mistaken for a real error.
+template <class T, class E> class expected_promise {
+  using state_type = expected_shared_state<T, E>;
+  state_type *m_state;
+
+  // If constructing the result throws, the promise keeps its state and can
+  // still be set again or abandoned.
+  template <class... Args> void set(Args &&... args) {
+    m_state->set(forward<Args>(args)...);
+    exchange(m_state, nullptr)->release();
+  }
+
+public:
+  expected_promise() : m_state(new state_type) {
+    m_state->m_owned = true;
+    m_state->acquire();
+  }
+  explicit expected_promise(state_type &state) noexcept
+      : m_state(addressof(state)) {
+    m_state->acquire();
+  }
+  expected_promise(expected_promise &&rhs) noexcept
+      : m_state(exchange(rhs.m_state, nullptr)) {}
+  expected_promise &operator=(expected_promise &&rhs) noexcept {
+    expected_promise(move(rhs)).swap(*this);
+    return *this;
+  }
+  ~expected_promise() {
+    if (m_state) {
+      m_state->abandon();
+      m_state->release();
+    }
+  }
+
+  void swap(expected_promise &rhs) noexcept {
+    using std::swap;
+    swap(m_state, rhs.m_state);
+  }
+
+  // Until a result is set.
+  bool valid() const noexcept { return m_state != nullptr; }
+
+  // At most once, before a result is set.
+  expected_future<T, E> get_future() noexcept {
+    return expected_future<T, E>(*m_state);
+  }
+
+  template <class... Args> void set_value(Args &&... args) {
+    set(in_place, forward<Args>(args)...);
+  }
+  template <class... Args> void set_error(Args &&... args) {
+    set(unexpect, forward<Args>(args)...);
+  }
+  void set_result(expected<T, E> result) { set(move(result)); }
+};
+
+template <class T, class E> class expected_future {
+  using state_type = expected_shared_state<T, E>;
+  state_type *m_state = nullptr;
+
+  friend class expected_promise<T, E>;
+  explicit expected_future(state_type &state) noexcept
+      : m_state(addressof(state)) {
+    m_state->acquire();
+  }
+
+public:
+  expected_future() noexcept = default;
+  expected_future(expected_future &&rhs) noexcept
+      : m_state(exchange(rhs.m_state, nullptr)) {}
+  expected_future &operator=(expected_future &&rhs) noexcept {
+    expected_future(move(rhs)).swap(*this);
+    return *this;
+  }
+  ~expected_future() {
+    if (m_state) {
+      m_state->release();
+    }
+  }
+
+  void swap(expected_future &rhs) noexcept {
+    using std::swap;
+    swap(m_state, rhs.m_state);
+  }
+
+  bool valid() const noexcept { return m_state != nullptr; }
+  // True once a result is set or the promise is broken.
+  bool is_ready() const noexcept { return m_state->is_ready(); }
+  // True once the promise was destroyed without setting a result.
+  bool is_broken() const noexcept { return m_state->is_broken(); }
+
+  void wait() const noexcept {
+    if (!m_state->is_ready()) {
+      m_state->wait();
+    }
+  }
+
+  // Waits and moves the result out; the future is no longer valid after.
+  // There is no result to return from a broken promise, so this terminates;
+  // check is_broken() first or use get_or().
+  expected<T, E> get() {
+    wait();
+    if (m_state->is_broken()) {
+      terminate();
+    }
+    return take();
+  }
+
+  // As get(), but a broken promise gives an error constructed from
+  // on_broken.
+  template <class G> expected<T, E> get_or(G &&on_broken) {
+    wait();
+    if (m_state->is_broken()) {
+      exchange(m_state, nullptr)->release();
+      return expected<T, E>(unexpect, forward<G>(on_broken));
+    }
+    return take();
+  }
+
+private:
+  expected<T, E> take() {
+    expected<T, E> result(move(m_state->m_result));
+    exchange(m_state, nullptr)->release();
+    return result;
+  }
+};
+
+template <class T, class E>
+void swap(expected_promise<T, E> &x, expected_promise<T, E> &y) noexcept {
+  x.swap(y);
+}
+template <class T, class E>
+void swap(expected_future<T, E> &x, expected_future<T, E> &y) noexcept {
+  x.swap(y);
+}
+
+} // namespace fundamentals_v3
+} // namespace std::experimental
@@ -0,0 +1,136 @@
+// SPDX-License-Identifier: CC0-1.0
+///
+// expected - An c++17 implementation of std::expected with extensions
+//
+// To the extent possible under law, the author(s) have dedicated all
+// copyright and related and neighboring rights to this software to the
+// public domain worldwide. This software is distributed without any warranty.
+//
+// You should have received a copy of the CC0 Public Domain Dedication
+// along with this software. If not, see
+// <http://creativecommons.org/publicdomain/zero/1.0/>.
+///
+
+#pragma once
+#include <experimental/expected.hpp>
+#include <limits>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_set>
+
+namespace std::experimental {
+inline namespace fundamentals_v3 {
+
+// The process wide set of interned values of E. Records are immutable and
+// never freed, so the table grows by one record per distinct value for the
+// life of the process. Interning suits error types with a bounded set of
+// values such as a code plus a fixed message; anything that varies per
+// occurrence, like an id or a path, belongs next to the interned error
+// rather than inside it. The table is split into shards with their own
+// reader/writer lock, and each thread keeps a small direct-mapped cache of
+// the records it has looked up in front of it, so a value a thread has seen
+// recently is found without touching a lock.
+template <class E, class Hash = hash<E>, class Equal = equal_to<E>>
+class error_intern_table {
+  static constexpr size_t shard_bits = 4;
+  static constexpr size_t shard_count = size_t(1) << shard_bits;
+  static constexpr size_t cache_bits = 6;
+
+  struct cache_entry {
+    size_t m_hash;
+    const E *m_record;
+  };
+
+  struct alignas(64) shard {
+    shared_mutex m_mutex;
+    unordered_set<E, Hash, Equal> m_records;
+  };
+
+  shard m_shards[shard_count];
+
+  error_intern_table() = default;
+
+public:
+  error_intern_table(const error_intern_table &) = delete;
+  error_intern_table &operator=(const error_intern_table &) = delete;
+
+  static error_intern_table &instance() {
+    // Leaked on purpose so records outlive every static that refers to them.
+    static error_intern_table *table = new error_intern_table();
+    return *table;
+  }
+
+  template <class G> const E *intern(G &&error) {
+    const size_t h = Hash()(as_const(error));
+    // Fibonacci hashing, so identity hashes of small integers still spread.
+    const size_t mixed = h * size_t(0x9E3779B97F4A7C15ull);
+    // Records are never freed, so a cached pointer stays valid.
+    static thread_local cache_entry cache[size_t(1) << cache_bits] = {};
+    cache_entry &entry =
+        cache[mixed >> (numeric_limits<size_t>::digits - cache_bits)];
+    if (entry.m_record && entry.m_hash == h &&
+        Equal()(*entry.m_record, as_const(error))) {
+      return entry.m_record;
+    }
+    shard &s =
+        m_shards[mixed >> (numeric_limits<size_t>::digits - shard_bits)];
+    const E *record = [&] {
+      {
+        shared_lock<shared_mutex> lock(s.m_mutex);
+        auto it = s.m_records.find(error);
+        if (it != s.m_records.end()) {
+          return &*it;
+        }
+      }
+      lock_guard<shared_mutex> lock(s.m_mutex);
+      return &*s.m_records.emplace(forward<G>(error)).first;
+    }();
+    entry = {h, record};
+    return record;
+  }
+
+  size_t size() {
+    size_t n = 0;
+    for (shard &s : m_shards) {
+      shared_lock<shared_mutex> lock(s.m_mutex);
+      n += s.m_records.size();
+    }
+    return n;
+  }
+};
+
+// A pointer to an interned E. Equal errors share one record, so copying an
+// interned_error, e.g. when an error passes through and_then, copies a
+// pointer, and comparing two compares pointers.
+template <class E, class Hash = hash<E>, class Equal = equal_to<E>>
+class interned_error {
+  const E *m_record;
+
+public:
+  using error_type = E;
+  using table_type = error_intern_table<E, Hash, Equal>;
+
+  interned_error(const E &error)
+      : m_record(table_type::instance().intern(error)) {}
+  interned_error(E &&error)
+      : m_record(table_type::instance().intern(move(error))) {}
+
+  const E &error() const noexcept { return *m_record; }
+  const E &operator*() const noexcept { return *m_record; }
+  const E *operator->() const noexcept { return m_record; }
+
+  friend bool operator==(interned_error x, interned_error y) noexcept {
+    return x.m_record == y.m_record;
+  }
+  friend bool operator!=(interned_error x, interned_error y) noexcept {
+    return x.m_record != y.m_record;
+  }
+};
+
+template <class E>
+unexpected<interned_error<decay_t<E>>> make_interned_unexpected(E &&error) {
+  return unexpected<interned_error<decay_t<E>>>(forward<E>(error));
+}
+
+} // namespace fundamentals_v3
+} // namespace std::experimental
@@ -0,0 +1,108 @@
+// SPDX-License-Identifier: CC0-1.0
+///
+// expected - An c++17 implementation of std::expected with extensions
+//
+// To the extent possible under law, the author(s) have dedicated all
+// copyright and related and neighboring rights to this software to the
+// public domain worldwide. This software is distributed without any warranty.
+//
+// You should have received a copy of the CC0 Public Domain Dedication
+// along with this software. If not, see
+// <http://creativecommons.org/publicdomain/zero/1.0/>.
+///
+
+#pragma once
+#include <atomic>
+#include <experimental/expected.hpp>
+#include <functional>
+#include <mutex>
+#include <optional>
+
+namespace std::experimental {
+inline namespace fundamentals_v3 {
+
+// Whether a lazy_expected keeps an error for good, or calls the factory again
+// on the next access.
+enum class lazy_error_policy { cache, retry };
+
+// Calls the factory on first access, at most once per published result, and
+// hands out the result from then on. Once a result is published readers pay a
+// single acquire load. The factory runs under a mutex; if it throws, nothing is
+// published and the next access calls it again.
+template <class T, class E, lazy_error_policy Policy = lazy_error_policy::cache,
+          class F = function<expected<T, E>()>>
+class lazy_expected {
+  static_assert(is_same_v<detail::remove_cvref_t<invoke_result_t<F &>>,
+                          expected<T, E>>,
+                "F must return expected<T, E>");
+
+  atomic<bool> m_ready{false};
+  mutex m_mutex;
+  optional<expected<T, E>> m_result;
+  F m_factory;
+
+  // Returns the published result, or the error of a failed attempt that was
+  // not published.
+  optional<E> compute() {
+    lock_guard<mutex> lock(m_mutex);
+    if (!m_ready.load(memory_order_relaxed)) {
+      expected<T, E> result = invoke(m_factory);
+      if (Policy == lazy_error_policy::retry && !result) {
+        return optional<E>(move(result).error());
+      }
+      m_result.emplace(move(result));
+      m_ready.store(true, memory_order_release);
+    }
+    return nullopt;
+  }
+
+public:
+  using value_type = T;
+  using error_type = E;
+
+  explicit lazy_expected(F factory) : m_factory(move(factory)) {}
+  lazy_expected(const lazy_expected &) = delete;
+  lazy_expected &operator=(const lazy_expected &) = delete;
+
+  bool is_ready() const noexcept {
+    return m_ready.load(memory_order_acquire);
+  }
+
+  // With the cache policy the result itself, errors included.
+  template <lazy_error_policy P = Policy,
+            enable_if_t<P == lazy_error_policy::cache> * = nullptr>
+  const expected<T, E> &get() {
+    if (!m_ready.load(memory_order_acquire)) {
+      compute();
+    }
+    return *m_result;
+  }
+
+  // With the retry policy only values are kept, so an error is returned by
+  // value and the value by reference.
+  template <lazy_error_policy P = Policy,
+            enable_if_t<P == lazy_error_policy::retry> * = nullptr>
+  auto get() {
+    using result = conditional_t<is_void_v<T>, expected<void, E>,
+                                 expected<reference_wrapper<const T>, E>>;
+    if (!m_ready.load(memory_order_acquire)) {
+      if (optional<E> error = compute()) {
+        return result(unexpect, move(*error));
+      }
+    }
+    if constexpr (is_void_v<T>) {
+      return result();
+    } else {
+      return result(cref(**m_result));
+    }
+  }
+};
+
+template <class F>
+lazy_expected(F)
+    -> lazy_expected<typename invoke_result_t<F &>::value_type,
+                     typename invoke_result_t<F &>::error_type,
+                     lazy_error_policy::cache, F>;
+
+} // namespace fundamentals_v3
+} // namespace std::experimental
@@ -0,0 +1,431 @@
+// SPDX-License-Identifier: CC0-1.0
+///
+// expected - An c++17 implementation of std::expected with extensions
+//
+// To the extent possible under law, the author(s) have dedicated all
+// copyright and related and neighboring rights to this software to the
+// public domain worldwide. This software is distributed without any warranty.
+//
+// You should have received a copy of the CC0 Public Domain Dedication
+// along with this software. If not, see
+// <http://creativecommons.org/publicdomain/zero/1.0/>.
+///
+
+#pragma once
+#include <experimental/expected.hpp>
+#include <tuple>
+
+namespace std::experimental {
+inline namespace fundamentals_v3 {
+
+template <class Exp, class... Stages> class expected_pipeline;
+template <class... Stages> class expected_closure;
+
+namespace detail {
+
+struct pipeline_map_tag {};
+struct pipeline_and_then_tag {};
+struct pipeline_map_error_tag {};
+struct pipeline_or_else_tag {};
+struct pipeline_value_or_tag {};
+
+// m_f is the callable of the stage, or the default value for value_or.
+template <class Tag, class F> struct pipeline_stage {
+  using tag = Tag;
+  F m_f;
+};
+
+template <class Stage>
+using pipeline_tag_t = typename remove_cvref_t<Stage>::tag;
+template <class Stage>
+using pipeline_function_t = decltype((declval<Stage>().m_f));
+
+template <class F, class V> struct pipeline_invoke {
+  using type = invoke_result_t<F, V>;
+};
+template <class F> struct pipeline_invoke<F, void> {
+  using type = invoke_result_t<F>;
+};
+template <class F, class V>
+using pipeline_invoke_t = typename pipeline_invoke<F, V>::type;
+
+// Forwarding type of a prvalue handed to the next stage.
+template <class R>
+using pipeline_forward_t = conditional_t<is_void_v<R> || is_reference_v<R>, R,
+                                         add_rvalue_reference_t<R>>;
+
+// Type-level walk over the stages along the success path. V and Err are the
+// reference types the next stage will be invoked with.
+template <class Tag, class F, class V, class Err> struct pipeline_step;
+
+template <class F, class V, class Err>
+struct pipeline_step<pipeline_map_tag, F, V, Err> {
+  using value = pipeline_forward_t<pipeline_invoke_t<F, V>>;
+  using error = Err;
+};
+
+template <class F, class V, class Err>
+struct pipeline_step<pipeline_and_then_tag, F, V, Err> {
+  using result = remove_cvref_t<pipeline_invoke_t<F, V>>;
+  static_assert(is_expected_v<result>, "F must return an expected");
+  using value = add_rvalue_reference_t<typename result::value_type>;
+  using error = add_rvalue_reference_t<typename result::error_type>;
+};
+
+template <class F, class V, class Err>
+struct pipeline_step<pipeline_map_error_tag, F, V, Err> {
+  using result = invoke_result_t<F, Err>;
+  using value = V;
+  using error = conditional_t<is_void_v<result>, monostate &&,
+                              pipeline_forward_t<result>>;
+};
+
+template <class F, class V, class Err>
+struct pipeline_step<pipeline_or_else_tag, F, V, Err> {
+  using result = invoke_result_t<F, Err>;
+  static_assert(is_void_v<result> ||
+                    is_same_v<remove_cvref_t<result>,
+                              expected<remove_cvref_t<V>, remove_cvref_t<Err>>>,
+                "F must return void or the same expected");
+  using value = V;
+  using error = Err;
+};
+
+template <class D, class V, class Err>
+struct pipeline_step<pipeline_value_or_tag, D, V, Err> {
+  static_assert(!is_void_v<V>, "value_or needs a value type");
+  static_assert(is_convertible_v<D, remove_cvref_t<V>>,
+                "T must be convertible to from U");
+  using value = V;
+  using error = Err;
+};
+
+template <class V, class Err, class... Stages> struct pipeline_traits {
+  using result = expected<remove_cvref_t<V>, remove_cvref_t<Err>>;
+  using errors = tuple<>;
+};
+
+template <class V, class Err, class Stage, class... Stages>
+struct pipeline_traits<V, Err, Stage, Stages...> {
+  static inline constexpr bool terminal =
+      is_same_v<pipeline_tag_t<Stage>, pipeline_value_or_tag>;
+  static_assert(!terminal || sizeof...(Stages) == 0,
+                "value_or must be the last stage");
+
+  using step =
+      pipeline_step<pipeline_tag_t<Stage>, pipeline_function_t<Stage>, V, Err>;
+  using next = pipeline_traits<typename step::value, typename step::error,
+                               Stages...>;
+  using result =
+      conditional_t<terminal, remove_cvref_t<V>, typename next::result>;
+  // Error type on the success path right after each stage.
+  using errors =
+      decltype(tuple_cat(declval<tuple<remove_cvref_t<typename step::error>>>(),
+                         declval<typename next::errors>()));
+};
+
+template <class Exp,
+          class V = conditional_t<
+              is_void_v<typename remove_cvref_t<Exp>::value_type>, void,
+              decltype(*declval<Exp>())>,
+          class Err = decltype(declval<Exp>().error())>
+struct pipeline_source {
+  using value = V;
+  using error = Err;
+};
+
+// Stages are seen with the value category of the tuple holding them: a
+// consumed pipeline invokes its callables as rvalues, a stored closure as
+// const lvalues.
+template <class Exp, class Stages> struct pipeline_traits_for;
+template <class Exp, class... Stages>
+struct pipeline_traits_for<Exp, tuple<Stages...> &&> {
+  using type = pipeline_traits<typename pipeline_source<Exp>::value,
+                               typename pipeline_source<Exp>::error,
+                               Stages &&...>;
+};
+template <class Exp, class... Stages>
+struct pipeline_traits_for<Exp, const tuple<Stages...> &> {
+  using type = pipeline_traits<typename pipeline_source<Exp>::value,
+                               typename pipeline_source<Exp>::error,
+                               const Stages &...>;
+};
+template <class Exp, class Stages>
+using pipeline_traits_t = typename pipeline_traits_for<Exp, Stages>::type;
+
+// Runs every stage of a pipeline in a single call. The value travels through
+// value<I>() and an error jumps to error<I>(), which only stops at the stages
+// that act on errors; no intermediate expected is materialized.
+template <class Traits, class Stages> struct pipeline_evaluator {
+  using result_type = typename Traits::result;
+  using stages_type = remove_cvref_t<Stages>;
+  static inline constexpr size_t size = tuple_size_v<stages_type>;
+
+  remove_reference_t<Stages> &m_stages;
+
+  template <size_t I> constexpr decltype(auto) stage() {
+    return get<I>(static_cast<Stages &&>(m_stages));
+  }
+
+  template <size_t I, class... V> constexpr result_type value(V &&...v) {
+    if constexpr (I == size) {
+      if constexpr (sizeof...(V) == 0) {
+        return result_type();
+      } else {
+        return result_type(in_place, forward<V>(v)...);
+      }
+    } else {
+      using tag = typename tuple_element_t<I, stages_type>::tag;
+      using F = pipeline_function_t<decltype(stage<I>())>;
+      F f = stage<I>().m_f;
+      if constexpr (is_same_v<tag, pipeline_map_tag>) {
+        if constexpr (is_void_v<decltype(invoke(forward<F>(f),
+                                                  forward<V>(v)...))>) {
+          invoke(forward<F>(f), forward<V>(v)...);
+          return value<I + 1>();
+        } else {
+          return value<I + 1>(invoke(forward<F>(f), forward<V>(v)...));
+        }
+      } else if constexpr (is_same_v<tag, pipeline_and_then_tag>) {
+        auto r = invoke(forward<F>(f), forward<V>(v)...);
+        if (!r.has_value()) {
+          return error<I + 1>(move(r).error());
+        }
+        if constexpr (is_void_v<typename decltype(r)::value_type>) {
+          return value<I + 1>();
+        } else {
+          return value<I + 1>(*move(r));
+        }
+      } else if constexpr (is_same_v<tag, pipeline_value_or_tag>) {
+        return result_type(forward<V>(v)...);
+      } else {
+        return value<I + 1>(forward<V>(v)...);
+      }
+    }
+  }
+
+  template <size_t I, class Err> constexpr result_type error(Err &&e) {
+    if constexpr (I == size) {
+      return result_type(unexpect, forward<Err>(e));
+    } else {
+      using tag = typename tuple_element_t<I, stages_type>::tag;
+      using F = pipeline_function_t<decltype(stage<I>())>;
+      F f = stage<I>().m_f;
+      if constexpr (is_same_v<tag, pipeline_and_then_tag>) {
+        using G = tuple_element_t<I, typename Traits::errors>;
+        if constexpr (is_same_v<remove_cvref_t<Err>, G>) {
+          return error<I + 1>(forward<Err>(e));
+        } else {
+          return error<I + 1>(G(forward<Err>(e)));
+        }
+      } else if constexpr (is_same_v<tag, pipeline_map_error_tag>) {
+        if constexpr (is_void_v<invoke_result_t<F, Err>>) {
+          invoke(forward<F>(f), forward<Err>(e));
+          return error<I + 1>(monostate());
+        } else {
+          return error<I + 1>(invoke(forward<F>(f), forward<Err>(e)));
+        }
+      } else if constexpr (is_same_v<tag, pipeline_or_else_tag>) {
+        if constexpr (is_void_v<invoke_result_t<F, Err>>) {
+          invoke(forward<F>(f), forward<Err>(e));
+          return error<I + 1>(forward<Err>(e));
+        } else {
+          auto r = invoke(forward<F>(f), forward<Err>(e));
+          if (!r.has_value()) {
+            return error<I + 1>(move(r).error());
+          }
+          if constexpr (is_void_v<typename decltype(r)::value_type>) {
+            return value<I + 1>();
+          } else {
+            return value<I + 1>(*move(r));
+          }
+        }
+      } else if constexpr (is_same_v<tag, pipeline_value_or_tag>) {
+        return static_cast<result_type>(forward<F>(f));
+      } else {
+        return error<I + 1>(forward<Err>(e));
+      }
+    }
+  }
+};
+
+template <class Exp, class Stages>
+constexpr auto pipeline_evaluate(Exp &&exp, Stages &&stages) {
+  using traits = pipeline_traits_t<Exp, Stages &&>;
+  pipeline_evaluator<traits, Stages &&> evaluator{stages};
+  if (!exp.has_value()) {
+    return evaluator.template error<0>(forward<Exp>(exp).error());
+  }
+  if constexpr (is_void_v<typename remove_cvref_t<Exp>::value_type>) {
+    return evaluator.template value<0>();
+  } else {
+    return evaluator.template value<0>(*forward<Exp>(exp));
+  }
+}
+
+// A single stage goes through the same code path as the member functions.
+template <class Exp, class Stage>
+constexpr auto pipeline_apply_stage(Exp &&exp, Stage &&stage) {
+  using tag = pipeline_tag_t<Stage>;
+  if constexpr (is_same_v<tag, pipeline_map_tag>) {
+    return expected_map_impl(forward<Exp>(exp), forward<Stage>(stage).m_f);
+  } else if constexpr (is_same_v<tag, pipeline_and_then_tag>) {
+    return expected_and_then_impl(forward<Exp>(exp), forward<Stage>(stage).m_f);
+  } else if constexpr (is_same_v<tag, pipeline_map_error_tag>) {
+    return expected_map_error_impl(forward<Exp>(exp),
+                                   forward<Stage>(stage).m_f);
+  } else if constexpr (is_same_v<tag, pipeline_or_else_tag>) {
+    return expected_or_else_impl(forward<Exp>(exp), forward<Stage>(stage).m_f);
+  } else {
+    return forward<Exp>(exp).value_or(forward<Stage>(stage).m_f);
+  }
+}
+
+template <class T> struct is_expected_closure : false_type {};
+template <class... Stages>
+struct is_expected_closure<expected_closure<Stages...>> : true_type {};
+template <class T>
+static inline constexpr bool is_expected_closure_v =
+    is_expected_closure<T>::value;
+
+} // namespace detail
+
+// Records map / and_then / map_error / or_else stages without running them.
+// eval() runs the whole chain as one fused call: the value flows through the
+// stages as plain arguments and an error is moved once, straight to the result.
+// A pipeline refers to its source, so an rvalue source must be evaluated within
+// the full-expression that built the pipeline.
+template <class Exp, class... Stages> class expected_pipeline {
+  static_assert(detail::is_expected_v<detail::remove_cvref_t<Exp>>,
+                "Exp must be an expected");
+
+  template <class Tag, class F> constexpr auto append(F &&f) {
+    using stage = detail::pipeline_stage<Tag, decay_t<F>>;
+    return expected_pipeline<Exp, Stages..., stage>(
+        forward<Exp>(m_exp),
+        tuple_cat(move(m_stages), tuple<stage>(stage{forward<F>(f)})));
+  }
+
+  Exp &&m_exp;
+  tuple<Stages...> m_stages;
+
+public:
+  using result_type =
+      typename detail::pipeline_traits_t<Exp, tuple<Stages...> &&>::result;
+
+  constexpr expected_pipeline(Exp &&exp, tuple<Stages...> &&stages)
+      : m_exp(forward<Exp>(exp)), m_stages(move(stages)) {}
+
+  template <class F> constexpr auto map(F &&f) && {
+    return append<detail::pipeline_map_tag>(forward<F>(f));
+  }
+  template <class F> constexpr auto and_then(F &&f) && {
+    return append<detail::pipeline_and_then_tag>(forward<F>(f));
+  }
+  template <class F> constexpr auto map_error(F &&f) && {
+    return append<detail::pipeline_map_error_tag>(forward<F>(f));
+  }
+  template <class F> constexpr auto or_else(F &&f) && {
+    return append<detail::pipeline_or_else_tag>(forward<F>(f));
+  }
+  template <class U> constexpr auto value_or(U &&v) && {
+    return append<detail::pipeline_value_or_tag>(forward<U>(v)).eval();
+  }
+
+  constexpr result_type eval() && {
+    return detail::pipeline_evaluate(forward<Exp>(m_exp), move(m_stages));
+  }
+  constexpr operator result_type() && { return move(*this).eval(); }
+};
+
+template <class Exp,
+          enable_if_t<detail::is_expected_v<detail::remove_cvref_t<Exp>>> * =
+              nullptr>
+constexpr auto pipeline(Exp &&exp) {
+  return expected_pipeline<Exp>(forward<Exp>(exp), tuple<>());
+}
+
+// Stages detached from any source, built with map(f), and_then(f) ... and
+// joined with operator|. A closure can be stored and applied to any number of
+// expected; a composed closure is applied as one fused call.
+template <class... Stages> class expected_closure {
+  tuple<Stages...> m_stages;
+
+  template <class... Others> friend class expected_closure;
+
+public:
+  constexpr explicit expected_closure(tuple<Stages...> stages)
+      : m_stages(move(stages)) {}
+
+  template <class... Others>
+  constexpr auto then(const expected_closure<Others...> &rhs) const & {
+    return expected_closure<Stages..., Others...>(
+        tuple_cat(m_stages, rhs.m_stages));
+  }
+  template <class... Others>
+  constexpr auto then(expected_closure<Others...> &&rhs) && {
+    return expected_closure<Stages..., Others...>(
+        tuple_cat(move(m_stages), move(rhs.m_stages)));
+  }
+
+  template <class Exp> constexpr auto operator()(Exp &&exp) const & {
+    if constexpr (sizeof...(Stages) == 1) {
+      return detail::pipeline_apply_stage(forward<Exp>(exp), get<0>(m_stages));
+    } else {
+      return detail::pipeline_evaluate(forward<Exp>(exp), as_const(m_stages));
+    }
+  }
+  template <class Exp> constexpr auto operator()(Exp &&exp) && {
+    if constexpr (sizeof...(Stages) == 1) {
+      return detail::pipeline_apply_stage(forward<Exp>(exp),
+                                          get<0>(move(m_stages)));
+    } else {
+      return detail::pipeline_evaluate(forward<Exp>(exp), move(m_stages));
+    }
+  }
+};
+
+template <class F> constexpr auto map(F &&f) {
+  using stage = detail::pipeline_stage<detail::pipeline_map_tag, decay_t<F>>;
+  return expected_closure<stage>(tuple<stage>(stage{forward<F>(f)}));
+}
+template <class F> constexpr auto and_then(F &&f) {
+  using stage =
+      detail::pipeline_stage<detail::pipeline_and_then_tag, decay_t<F>>;
+  return expected_closure<stage>(tuple<stage>(stage{forward<F>(f)}));
+}
+template <class F> constexpr auto map_error(F &&f) {
+  using stage =
+      detail::pipeline_stage<detail::pipeline_map_error_tag, decay_t<F>>;
+  return expected_closure<stage>(tuple<stage>(stage{forward<F>(f)}));
+}
+template <class F> constexpr auto or_else(F &&f) {
+  using stage =
+      detail::pipeline_stage<detail::pipeline_or_else_tag, decay_t<F>>;
+  return expected_closure<stage>(tuple<stage>(stage{forward<F>(f)}));
+}
+template <class U> constexpr auto value_or(U &&v) {
+  using stage =
+      detail::pipeline_stage<detail::pipeline_value_or_tag, decay_t<U>>;
+  return expected_closure<stage>(tuple<stage>(stage{forward<U>(v)}));
+}
+
+template <class Exp, class Closure,
+          enable_if_t<detail::is_expected_v<detail::remove_cvref_t<Exp>> &&
+                      detail::is_expected_closure_v<
+                          detail::remove_cvref_t<Closure>>> * = nullptr>
+constexpr auto operator|(Exp &&exp, Closure &&closure) {
+  return forward<Closure>(closure)(forward<Exp>(exp));
+}
+
+template <
+    class Lhs, class Rhs,
+    enable_if_t<detail::is_expected_closure_v<detail::remove_cvref_t<Lhs>> &&
+                detail::is_expected_closure_v<detail::remove_cvref_t<Rhs>>> * =
+        nullptr>
+constexpr auto operator|(Lhs &&lhs, Rhs &&rhs) {
+  return forward<Lhs>(lhs).then(forward<Rhs>(rhs));
+}
+
+} // namespace fundamentals_v3
+} // namespace std::experimental
@@ -0,0 +1,361 @@
+// SPDX-License-Identifier: CC0-1.0
+///
+// expected - An c++17 implementation of std::expected with extensions
+//
+// To the extent possible under law, the author(s) have dedicated all
+// copyright and related and neighboring rights to this software to the
+// public domain worldwide. This software is distributed without any warranty.
+//
+// You should have received a copy of the CC0 Public Domain Dedication
+// along with this software. If not, see
+// <http://creativecommons.org/publicdomain/zero/1.0/>.
+///
+
+#pragma once
+#include <experimental/expected.hpp>
+#include <iterator>
+#include <memory>
+#include <optional>
+#if __has_include(<version>)
+#include <version>
+#endif
+#if defined(__cpp_lib_ranges)
+#include <ranges>
+#endif
+
+namespace std::experimental {
+inline namespace fundamentals_v3 {
+
+namespace detail {
+
+#if defined(__cpp_lib_ranges)
+template <class View>
+using expected_range_view_base = ranges::view_interface<View>;
+#else
+template <class View> struct expected_range_view_base {};
+#endif
+
+// Holds an lvalue range by pointer (so views stay assignable) and an rvalue
+// range by value.
+template <class R> class range_holder {
+  R m_range;
+
+public:
+  constexpr explicit range_holder(R &&r) : m_range(move(r)) {}
+  constexpr R &get() noexcept { return m_range; }
+};
+template <class R> class range_holder<R &> {
+  R *m_range;
+
+public:
+  constexpr explicit range_holder(R &r) noexcept : m_range(addressof(r)) {}
+  constexpr R &get() noexcept { return *m_range; }
+};
+
+template <class It> class iterator_range {
+  It m_first;
+  It m_last;
+
+public:
+  constexpr iterator_range(It first, It last)
+      : m_first(move(first)), m_last(move(last)) {}
+  constexpr It begin() const { return m_first; }
+  constexpr It end() const { return m_last; }
+};
+
+template <class R> using range_iterator_t = decltype(begin(declval<R &>()));
+
+// Forward only when the underlying iterator is and the view hands out lvalue
+// references that outlive the iterator; an element cached in the iterator or
+// returned as a prvalue makes the view single pass.
+template <class It, class Reference>
+using range_category_t = conditional_t<
+    is_base_of_v<forward_iterator_tag,
+                 typename iterator_traits<It>::iterator_category> &&
+        is_lvalue_reference_v<Reference>,
+    forward_iterator_tag, input_iterator_tag>;
+
+// Walks an underlying iterator and keeps the current element alive. Ranges
+// that yield prvalues (e.g. a transform) are cached once per position, so
+// checking has_value() and reading the element don't evaluate it twice.
+template <class It> class expected_cursor {
+  using reference = decltype(*declval<It &>());
+
+public:
+  static inline constexpr bool caches = !is_reference_v<reference>;
+
+private:
+  using element = remove_cvref_t<reference>;
+  static_assert(is_expected_v<element>, "range must yield expected");
+
+  It m_cur{};
+  It m_end{};
+  mutable conditional_t<caches, optional<element>, monostate> m_cache;
+
+public:
+  using element_reference = conditional_t<caches, element &, reference>;
+
+  constexpr expected_cursor() = default;
+  constexpr expected_cursor(It cur, It end)
+      : m_cur(move(cur)), m_end(move(end)) {
+    load();
+  }
+
+  constexpr bool done() const { return m_cur == m_end; }
+  constexpr const It &base() const noexcept { return m_cur; }
+  constexpr element_reference get() const {
+    if constexpr (caches) {
+      return *m_cache;
+    } else {
+      return *m_cur;
+    }
+  }
+  constexpr void next() {
+    ++m_cur;
+    load();
+  }
+
+private:
+  constexpr void load() {
+    if constexpr (caches) {
+      if (!done()) {
+        m_cache.emplace(*m_cur);
+      }
+    }
+  }
+};
+
+struct only_values_kind {};
+struct only_errors_kind {};
+struct values_until_error_kind {};
+
+template <class It, class Kind> class expected_filter_iterator {
+  using cursor = expected_cursor<It>;
+  using element_reference = typename cursor::element_reference;
+
+  cursor m_cursor;
+  bool m_end = true;
+
+  constexpr void satisfy() {
+    if constexpr (is_same_v<Kind, only_values_kind>) {
+      while (!m_cursor.done() && !m_cursor.get().has_value()) {
+        m_cursor.next();
+      }
+      m_end = m_cursor.done();
+    } else if constexpr (is_same_v<Kind, only_errors_kind>) {
+      while (!m_cursor.done() && m_cursor.get().has_value()) {
+        m_cursor.next();
+      }
+      m_end = m_cursor.done();
+    } else {
+      m_end = m_cursor.done() || !m_cursor.get().has_value();
+    }
+  }
+
+public:
+  using reference =
+      conditional_t<is_same_v<Kind, only_errors_kind>,
+                    decltype(declval<element_reference>().error()),
+                    decltype(*declval<element_reference>())>;
+  using value_type = remove_cvref_t<reference>;
+  using difference_type = ptrdiff_t;
+  using pointer = add_pointer_t<reference>;
+  using iterator_category =
+      range_category_t<It, conditional_t<cursor::caches, void, reference>>;
+
+  constexpr expected_filter_iterator() = default;
+  constexpr expected_filter_iterator(It cur, It end)
+      : m_cursor(move(cur), move(end)) {
+    satisfy();
+  }
+
+  // The underlying position; for values_until_error this is the first error
+  // once the iteration stopped early.
+  constexpr const It &base() const noexcept { return m_cursor.base(); }
+
+  constexpr reference operator*() const {
+    if constexpr (is_same_v<Kind, only_errors_kind>) {
+      return m_cursor.get().error();
+    } else {
+      return *m_cursor.get();
+    }
+  }
+  constexpr pointer operator->() const { return addressof(**this); }
+  constexpr expected_filter_iterator &operator++() {
+    m_cursor.next();
+    satisfy();
+    return *this;
+  }
+  constexpr expected_filter_iterator operator++(int) {
+    auto tmp = *this;
+    ++*this;
+    return tmp;
+  }
+
+  friend constexpr bool operator==(const expected_filter_iterator &x,
+                                   const expected_filter_iterator &y) {
+    if (x.m_end || y.m_end) {
+      return x.m_end == y.m_end;
+    }
+    return x.base() == y.base();
+  }
+  friend constexpr bool operator!=(const expected_filter_iterator &x,
+                                   const expected_filter_iterator &y) {
+    return !(x == y);
+  }
+};
+
+template <class R, class Kind>
+class expected_filter_view
+    : public expected_range_view_base<expected_filter_view<R, Kind>> {
+  using iterator_type =
+      expected_filter_iterator<range_iterator_t<remove_reference_t<R>>, Kind>;
+
+  range_holder<R> m_range;
+
+public:
+  constexpr explicit expected_filter_view(R &&r) : m_range(forward<R>(r)) {}
+
+  constexpr iterator_type begin() {
+    return iterator_type(std::begin(m_range.get()), std::end(m_range.get()));
+  }
+  constexpr iterator_type end() {
+    return iterator_type(std::end(m_range.get()), std::end(m_range.get()));
+  }
+};
+
+template <class It, class F> class expected_transform_iterator {
+  F *m_f = nullptr;
+  It m_cur{};
+
+  using source_reference = decltype(*declval<It &>());
+
+public:
+  using reference = decltype(declval<F &>()(declval<source_reference>()));
+  using value_type = remove_cvref_t<reference>;
+  using difference_type = ptrdiff_t;
+  using pointer = void;
+  using iterator_category = range_category_t<It, reference>;
+
+  constexpr expected_transform_iterator() = default;
+  constexpr expected_transform_iterator(F &f, It cur)
+      : m_f(addressof(f)), m_cur(move(cur)) {}
+
+  constexpr const It &base() const noexcept { return m_cur; }
+
+  constexpr reference operator*() const { return (*m_f)(*m_cur); }
+  constexpr expected_transform_iterator &operator++() {
+    ++m_cur;
+    return *this;
+  }
+  constexpr expected_transform_iterator operator++(int) {
+    auto tmp = *this;
+    ++*this;
+    return tmp;
+  }
+
+  friend constexpr bool operator==(const expected_transform_iterator &x,
+                                   const expected_transform_iterator &y) {
+    return x.m_cur == y.m_cur;
+  }
+  friend constexpr bool operator!=(const expected_transform_iterator &x,
+                                   const expected_transform_iterator &y) {
+    return !(x == y);
+  }
+};
+
+// Elements that are expected go through and_then (if F returns an expected)
+// or map; any other element is handed to F, which must return an expected.
+template <class F> struct expected_transform_fn {
+  F m_f;
+
+  template <class Elem> constexpr auto operator()(Elem &&elem) {
+    if constexpr (is_expected_v<remove_cvref_t<Elem>>) {
+      using T = typename remove_cvref_t<Elem>::value_type;
+      if constexpr (is_void_v<T>) {
+        if constexpr (is_expected_v<remove_cvref_t<invoke_result_t<F &>>>) {
+          return expected_and_then_impl(forward<Elem>(elem), m_f);
+        } else {
+          return expected_map_impl(forward<Elem>(elem), m_f);
+        }
+      } else if constexpr (is_expected_v<remove_cvref_t<invoke_result_t<
+                               F &, decltype(*declval<Elem>())>>>) {
+        return expected_and_then_impl(forward<Elem>(elem), m_f);
+      } else {
+        return expected_map_impl(forward<Elem>(elem), m_f);
+      }
+    } else {
+      using Ret = invoke_result_t<F &, Elem>;
+      static_assert(is_expected_v<remove_cvref_t<Ret>>,
+                    "F must return an expected");
+      return invoke(m_f, forward<Elem>(elem));
+    }
+  }
+};
+
+template <class R, class F>
+class expected_transform_view
+    : public expected_range_view_base<expected_transform_view<R, F>> {
+  using fn_type = expected_transform_fn<F>;
+  using iterator_type =
+      expected_transform_iterator<range_iterator_t<remove_reference_t<R>>,
+                                  fn_type>;
+
+  range_holder<R> m_range;
+  fn_type m_fn;
+
+public:
+  constexpr expected_transform_view(R &&r, F f)
+      : m_range(forward<R>(r)), m_fn{move(f)} {}
+
+  constexpr iterator_type begin() {
+    return iterator_type(m_fn, std::begin(m_range.get()));
+  }
+  constexpr iterator_type end() {
+    return iterator_type(m_fn, std::end(m_range.get()));
+  }
+};
+
+} // namespace detail
+
+// Lazy views over a range of expected. Each takes a range (held by reference
+// if it is an lvalue, moved in otherwise) or an iterator pair.
+template <class R> constexpr auto only_values(R &&r) {
+  return detail::expected_filter_view<R, detail::only_values_kind>(
+      forward<R>(r));
+}
+template <class It> constexpr auto only_values(It first, It last) {
+  return only_values(detail::iterator_range<It>(move(first), move(last)));
+}
+
+template <class R> constexpr auto only_errors(R &&r) {
+  return detail::expected_filter_view<R, detail::only_errors_kind>(
+      forward<R>(r));
+}
+template <class It> constexpr auto only_errors(It first, It last) {
+  return only_errors(detail::iterator_range<It>(move(first), move(last)));
+}
+
+// Stops at the first error without evaluating the rest of the range; the
+// iterator's base() then points to that error.
+template <class R> constexpr auto values_until_error(R &&r) {
+  return detail::expected_filter_view<R, detail::values_until_error_kind>(
+      forward<R>(r));
+}
+template <class It> constexpr auto values_until_error(It first, It last) {
+  return values_until_error(
+      detail::iterator_range<It>(move(first), move(last)));
+}
+
+template <class R, class F> constexpr auto transform_expected(R &&r, F &&f) {
+  return detail::expected_transform_view<R, decay_t<F>>(forward<R>(r),
+                                                        forward<F>(f));
+}
+template <class It, class F>
+constexpr auto transform_expected(It first, It last, F &&f) {
+  return transform_expected(detail::iterator_range<It>(move(first), move(last)),
+                            forward<F>(f));
+}
+
+} // namespace fundamentals_v3
+} // namespace std::experimental
@@ -0,0 +1,354 @@
+// SPDX-License-Identifier: CC0-1.0
+///
+// expected - An c++17 implementation of std::expected with extensions
+//
+// To the extent possible under law, the author(s) have dedicated all
+// copyright and related and neighboring rights to this software to the
+// public domain worldwide. This software is distributed without any warranty.
+//
+// You should have received a copy of the CC0 Public Domain Dedication
+// along with this software. If not, see
+// <http://creativecommons.org/publicdomain/zero/1.0/>.
+///
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <experimental/expected.hpp>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace std::experimental {
+inline namespace fundamentals_v3 {
+
+// One line for the sink: an error and how many occurrences it stands for.
+template <class E> struct error_report {
+  E error;
+  uint64_t count;
+};
+
+namespace detail {
+
+// A bounded multi-producer, single-consumer queue. Each cell carries a
+// sequence number telling producers and the consumer whose turn it is, so
+// neither side takes a lock.
+template <class T> class report_queue {
+  struct cell {
+    atomic<size_t> m_sequence;
+    alignas(T) unsigned char m_storage[sizeof(T)];
+
+    T &value() noexcept { return *launder(reinterpret_cast<T *>(m_storage)); }
+  };
+
+  const size_t m_mask;
+  const unique_ptr<cell[]> m_cells;
+  alignas(64) atomic<size_t> m_enqueue{0};
+  alignas(64) size_t m_dequeue = 0;
+
+public:
+  explicit report_queue(size_t capacity)
+      : m_mask([capacity] {
+          size_t n = 1;
+          while (n < capacity) {
+            n <<= 1;
+          }
+          return n - 1;
+        }()),
+        m_cells(new cell[m_mask + 1]) {
+    for (size_t i = 0; i <= m_mask; ++i) {
+      m_cells[i].m_sequence.store(i, memory_order_relaxed);
+    }
+  }
+  ~report_queue() {
+    while (try_pop([](T &&) {})) {
+    }
+  }
+
+  // Returns false if the queue is full.
+  template <class... Args> bool try_push(Args &&...args) {
+    size_t pos = m_enqueue.load(memory_order_relaxed);
+    for (;;) {
+      cell &c = m_cells[pos & m_mask];
+      const size_t sequence = c.m_sequence.load(memory_order_acquire);
+      const auto diff =
+          static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(pos);
+      if (diff == 0) {
+        if (m_enqueue.compare_exchange_weak(pos, pos + 1,
+                                            memory_order_relaxed)) {
+          new (c.m_storage) T(forward<Args>(args)...);
+          c.m_sequence.store(pos + 1, memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = m_enqueue.load(memory_order_relaxed);
+      }
+    }
+  }
+
+  // Consumer only.
+  template <class F> bool try_pop(F &&f) {
+    cell &c = m_cells[m_dequeue & m_mask];
+    if (c.m_sequence.load(memory_order_acquire) != m_dequeue + 1) {
+      return false;
+    }
+    f(move(c.value()));
+    c.value().~T();
+    c.m_sequence.store(m_dequeue + m_mask + 1, memory_order_release);
+    ++m_dequeue;
+    return true;
+  }
+};
+
+} // namespace detail
+
+// Collects errors from any thread and hands reports to sink on a background
+// thread. Per distinct error value at most reports_per_interval occurrences
+// in each interval are reported as they happen; the rest are only counted
+// and reported as one summary when the interval is over. Reporting threads
+// never wait for the sink or for each other on a value already seen: they
+// find its counter without locking and bump it atomically, and reports
+// travel through a lock-free queue that the background thread drains every
+// flush_period. Only the first occurrence of a new value takes its shard's
+// mutex, to insert it. Intervals, summaries and forgetting quiet values are
+// left to the background thread. When the queue is full a report is dropped
+// and counted in dropped().
+template <class E, class Hash = hash<E>, class Equal = equal_to<E>>
+class error_reporter {
+public:
+  using clock = chrono::steady_clock;
+  using sink_type = function<void(const error_report<E> &)>;
+
+private:
+  static constexpr size_t shard_count = 16;
+  static constexpr size_t bucket_count = 16;
+
+  struct key_node {
+    const E m_error;
+    // Occurrences in the current interval.
+    atomic<uint64_t> m_count{0};
+    atomic<key_node *> m_next{nullptr};
+
+    explicit key_node(const E &error) : m_error(error) {}
+  };
+
+  // Nodes are only linked in and unlinked under m_mutex, and read without
+  // it. An unlinked node is kept in m_retired until no reporting thread is
+  // inside the shard, so a reader never sees it freed.
+  struct alignas(64) shard {
+    mutex m_mutex;
+    atomic<size_t> m_readers{0};
+    atomic<key_node *> m_buckets[bucket_count] = {};
+    vector<key_node *> m_retired;
+  };
+
+  sink_type m_sink;
+  const size_t m_per_interval;
+  const clock::duration m_interval;
+  const clock::duration m_flush_period;
+  detail::report_queue<error_report<E>> m_queue;
+  atomic<uint64_t> m_dropped{0};
+  unique_ptr<shard[]> m_shards{new shard[shard_count]};
+
+  mutex m_wake_mutex;
+  condition_variable m_wake;
+  bool m_stop = false;
+  thread m_thread;
+
+  void enqueue(const E &error, uint64_t count) {
+    if (!m_queue.try_push(error_report<E>{error, count})) {
+      m_dropped.fetch_add(count, memory_order_relaxed);
+    }
+  }
+
+  void drain() {
+    while (m_queue.try_pop([this](error_report<E> &&r) { m_sink(r); })) {
+    }
+  }
+
+  // The first m_per_interval occurrences of an interval were reported as
+  // they happened; the rest go into its summary.
+  uint64_t suppressed(uint64_t count) const noexcept {
+    return count > m_per_interval ? count - m_per_interval : 0;
+  }
+
+  static key_node *find(atomic<key_node *> &bucket, const E &error) {
+    for (key_node *node = bucket.load(); node; node = node->m_next.load()) {
+      if (Equal()(node->m_error, error)) {
+        return node;
+      }
+    }
+    return nullptr;
+  }
+
+  static key_node *insert(shard &s, atomic<key_node *> &bucket,
+                          const E &error) {
+    lock_guard<mutex> lock(s.m_mutex);
+    if (key_node *node = find(bucket, error)) {
+      return node;
+    }
+    auto *node = new key_node(error);
+    node->m_next.store(bucket.load(memory_order_relaxed),
+                       memory_order_relaxed);
+    bucket.store(node);
+    return node;
+  }
+
+  // Whatever was counted on a retired node after its last sweep.
+  template <class Report> void release(key_node *node, Report &&report) {
+    if (const uint64_t count = suppressed(node->m_count.load())) {
+      report(node->m_error, count);
+    }
+    delete node;
+  }
+
+  // Ends the interval: reports what each value had suppressed in it and
+  // unlinks values that were quiet for all of it.
+  void sweep() {
+    const auto enqueue_fn = [this](const E &error, uint64_t count) {
+      enqueue(error, count);
+    };
+    for (size_t i = 0; i < shard_count; ++i) {
+      shard &s = m_shards[i];
+      lock_guard<mutex> lock(s.m_mutex);
+      for (atomic<key_node *> &bucket : s.m_buckets) {
+        atomic<key_node *> *link = &bucket;
+        while (key_node *node = link->load()) {
+          const uint64_t count = node->m_count.exchange(0);
+          if (count == 0) {
+            link->store(node->m_next.load());
+            s.m_retired.push_back(node);
+            continue;
+          }
+          if (const uint64_t rest = suppressed(count)) {
+            enqueue(node->m_error, rest);
+          }
+          link = &node->m_next;
+        }
+      }
+      if (!s.m_retired.empty() && s.m_readers.load() == 0) {
+        for (key_node *node : s.m_retired) {
+          release(node, enqueue_fn);
+        }
+        s.m_retired.clear();
+      }
+    }
+  }
+
+  // Once reporting has stopped nothing else touches the counters, so what is
+  // left goes to the sink directly rather than through the queue, where it
+  // could be dropped.
+  void finish() {
+    drain();
+    const auto sink_fn = [this](const E &error, uint64_t count) {
+      m_sink(error_report<E>{error, count});
+    };
+    for (size_t i = 0; i < shard_count; ++i) {
+      shard &s = m_shards[i];
+      for (atomic<key_node *> &bucket : s.m_buckets) {
+        key_node *node = bucket.exchange(nullptr);
+        while (node) {
+          key_node *const next = node->m_next.load();
+          release(node, sink_fn);
+          node = next;
+        }
+      }
+      for (key_node *node : s.m_retired) {
+        release(node, sink_fn);
+      }
+      s.m_retired.clear();
+    }
+  }
+
+  void run() {
+    auto next_sweep = clock::now() + m_interval;
+    unique_lock<mutex> lock(m_wake_mutex);
+    while (!m_stop) {
+      m_wake.wait_for(lock, m_flush_period);
+      lock.unlock();
+      if (clock::now() >= next_sweep) {
+        sweep();
+        next_sweep = clock::now() + m_interval;
+      }
+      drain();
+      lock.lock();
+    }
+    lock.unlock();
+    finish();
+  }
+
+public:
+  explicit error_reporter(
+      sink_type sink, size_t reports_per_interval = 1,
+      clock::duration interval = chrono::seconds(1), size_t buffer = 1024,
+      clock::duration flush_period = chrono::milliseconds(50))
+      : m_sink(move(sink)), m_per_interval(reports_per_interval),
+        m_interval(interval), m_flush_period(flush_period), m_queue(buffer),
+        m_thread([this] { run(); }) {}
+  error_reporter(const error_reporter &) = delete;
+  error_reporter &operator=(const error_reporter &) = delete;
+
+  // Reports whatever is still pending before returning.
+  ~error_reporter() {
+    {
+      lock_guard<mutex> lock(m_wake_mutex);
+      m_stop = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+  }
+
+  void report(const E &error) {
+    const size_t h = Hash()(error);
+    shard &s = m_shards[h % shard_count];
+    atomic<key_node *> &bucket = s.m_buckets[h / shard_count % bucket_count];
+    s.m_readers.fetch_add(1);
+    key_node *node = find(bucket, error);
+    if (!node) {
+      node = insert(s, bucket, error);
+    }
+    const uint64_t seen = node->m_count.fetch_add(1, memory_order_relaxed);
+    s.m_readers.fetch_sub(1, memory_order_release);
+    if (seen < m_per_interval) {
+      enqueue(error, 1);
+    }
+  }
+
+  // Occurrences lost because the queue was full.
+  uint64_t dropped() const noexcept {
+    return m_dropped.load(memory_order_relaxed);
+  }
+};
+
+namespace detail {
+
+template <class Reporter> class report_errors_fn {
+  Reporter *m_reporter;
+
+public:
+  explicit report_errors_fn(Reporter &reporter) noexcept
+      : m_reporter(&reporter) {}
+  template <class G> void operator()(const G &error) const {
+    m_reporter->report(error);
+  }
+};
+
+} // namespace detail
+
+// For or_else: r.or_else(report_errors(reporter)) reports the error and
+// passes r on unchanged.
+template <class E, class Hash, class Equal>
+detail::report_errors_fn<error_reporter<E, Hash, Equal>>
+report_errors(error_reporter<E, Hash, Equal> &reporter) noexcept {
+  return detail::report_errors_fn<error_reporter<E, Hash, Equal>>(reporter);
+}
+
+} // namespace fundamentals_v3
+} // namespace std::experimental
@@ -0,0 +1,162 @@
+// SPDX-License-Identifier: CC0-1.0
+///
+// expected - An c++17 implementation of std::expected with extensions
+//
+// To the extent possible under law, the author(s) have dedicated all
+// copyright and related and neighboring rights to this software to the
+// public domain worldwide. This software is distributed without any warranty.
+//
+// You should have received a copy of the CC0 Public Domain Dedication
+// along with this software. If not, see
+// <http://creativecommons.org/publicdomain/zero/1.0/>.
+///
+
+#pragma once
+#include <atomic>
+#include <experimental/expected.hpp>
+#include <memory>
+#include <new>
+#include <optional>
+
+namespace std::experimental {
+inline namespace fundamentals_v3 {
+
+// A bounded queue of expected<T, E> between exactly one producer thread and
+// one consumer thread. Slots are allocated once and results are constructed
+// in place, so nothing allocates after construction. The capacity is rounded
+// up to a power of two.
+template <class T, class E> class spsc_expected_ring {
+public:
+  using value_type = expected<T, E>;
+
+  // Completed slots that are contiguous in memory. They stay in the ring
+  // until the consumer calls pop(n).
+  class batch {
+    value_type *m_first;
+    size_t m_size;
+
+  public:
+    batch(value_type *first, size_t size) noexcept
+        : m_first(first), m_size(size) {}
+
+    value_type *data() const noexcept { return m_first; }
+    size_t size() const noexcept { return m_size; }
+    bool empty() const noexcept { return m_size == 0; }
+    value_type *begin() const noexcept { return m_first; }
+    value_type *end() const noexcept { return m_first + m_size; }
+    value_type &operator[](size_t i) const noexcept { return m_first[i]; }
+  };
+
+private:
+  static constexpr size_t cache_line = 64;
+
+  static size_t round_up(size_t n) noexcept {
+    size_t capacity = 1;
+    while (capacity < n) {
+      capacity <<= 1;
+    }
+    return capacity;
+  }
+
+  struct deleter {
+    void operator()(value_type *slots) const noexcept {
+      allocator<value_type>().deallocate(slots, m_capacity);
+    }
+    size_t m_capacity;
+  };
+
+  const size_t m_mask;
+  const unique_ptr<value_type[], deleter> m_slots;
+
+  // Each side owns one index and keeps a possibly stale copy of the other, so
+  // it only reads the other side's cache line when the copy says it must.
+  alignas(cache_line) atomic<size_t> m_tail{0};
+  size_t m_head_cache = 0;
+  alignas(cache_line) atomic<size_t> m_head{0};
+  size_t m_tail_cache = 0;
+
+  size_t readable() noexcept {
+    const size_t head = m_head.load(memory_order_relaxed);
+    if (m_tail_cache == head) {
+      m_tail_cache = m_tail.load(memory_order_acquire);
+    }
+    return m_tail_cache - head;
+  }
+
+public:
+  explicit spsc_expected_ring(size_t capacity)
+      : m_mask(round_up(capacity) - 1),
+        m_slots(allocator<value_type>().allocate(m_mask + 1),
+                deleter{m_mask + 1}) {}
+  spsc_expected_ring(const spsc_expected_ring &) = delete;
+  spsc_expected_ring &operator=(const spsc_expected_ring &) = delete;
+  ~spsc_expected_ring() { pop(size()); }
+
+  size_t capacity() const noexcept { return m_mask + 1; }
+  // Exact only on the producer or consumer thread.
+  size_t size() const noexcept {
+    return m_tail.load(memory_order_acquire) -
+           m_head.load(memory_order_acquire);
+  }
+
+  // Producer: constructs expected<T, E>(args...) in the next slot, so
+  // try_emplace(value), try_emplace(in_place, ...) and
+  // try_emplace(unexpect, ...) all work. Returns false if the ring is full.
+  template <class... Args> bool try_emplace(Args &&... args) {
+    const size_t tail = m_tail.load(memory_order_relaxed);
+    if (tail - m_head_cache > m_mask) {
+      m_head_cache = m_head.load(memory_order_acquire);
+      if (tail - m_head_cache > m_mask) {
+        return false;
+      }
+    }
+    new (&m_slots[tail & m_mask]) value_type(forward<Args>(args)...);
+    m_tail.store(tail + 1, memory_order_release);
+    return true;
+  }
+
+  // Consumer: calls f with the oldest result as an rvalue, then frees its
+  // slot. Returns false if the ring is empty.
+  template <class F> bool try_consume(F &&f) {
+    if (readable() == 0) {
+      return false;
+    }
+    invoke(forward<F>(f), move(m_slots[m_head.load(memory_order_relaxed) &
+                                       m_mask]));
+    pop(1);
+    return true;
+  }
+
+  // Consumer: moves the oldest result out.
+  optional<value_type> try_pop() {
+    optional<value_type> result;
+    try_consume([&result](value_type &&r) { result.emplace(move(r)); });
+    return result;
+  }
+
+  // Consumer: the completed slots from the oldest up to the end of the
+  // storage; call again after pop() to see any that wrapped around.
+  batch front() noexcept {
+    const size_t head = m_head.load(memory_order_relaxed);
+    const size_t first = head & m_mask;
+    const size_t contiguous = m_mask + 1 - first;
+    const size_t n = readable();
+    return batch(&m_slots[first], n < contiguous ? n : contiguous);
+  }
+
+  // Consumer: destroys the n oldest results and frees their slots; there
+  // must be at least n.
+  void pop(size_t n) noexcept {
+    const size_t head = m_head.load(memory_order_relaxed);
+    for (size_t i = 0; i < n; ++i) {
+      m_slots[(head + i) & m_mask].~value_type();
+    }
+    if (m_tail_cache - head < n) {
+      m_tail_cache = head + n;
+    }
+    m_head.store(head + n, memory_order_release);
+  }
+};
+
+} // namespace fundamentals_v3
+} // namespace std::experimental
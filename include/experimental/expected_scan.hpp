@@ -0,0 +1,387 @@
+// SPDX-License-Identifier: CC0-1.0
+///
+// expected - An c++17 implementation of std::expected with extensions
+//
+// To the extent possible under law, the author(s) have dedicated all
+// copyright and related and neighboring rights to this software to the
+// public domain worldwide. This software is distributed without any warranty.
+//
+// You should have received a copy of the CC0 Public Domain Dedication
+// along with this software. If not, see
+// <http://creativecommons.org/publicdomain/zero/1.0/>.
+///
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <experimental/expected.hpp>
+#include <iterator>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define EXPECTED_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace std::experimental {
+inline namespace fundamentals_v3 {
+
+namespace detail {
+
+// Byte offset of m_has_val inside expected<T, E>. Every
+// expected_storage_base specialization declares m_has_val protected, so
+// &expected_storage_base<T, E>::m_has_val does not compile out here. A
+// derived class may form that member pointer, and applying it to the base
+// subobject of exp is not access checked.
+template <class T, class E>
+struct expected_layout : expected_storage_base<T, E> {
+  static size_t has_val_offset(const expected<T, E> &exp) noexcept {
+    constexpr bool expected_storage_base<T, E>::*flag =
+        &expected_layout::m_has_val;
+    const expected_storage_base<T, E> &base = exp;
+    return static_cast<size_t>(reinterpret_cast<const unsigned char *>(
+                                   addressof(base.*flag)) -
+                               reinterpret_cast<const unsigned char *>(
+                                   addressof(exp)));
+  }
+};
+
+enum class scan_isa { scalar, sse2, avx2 };
+
+inline scan_isa scan_best_isa() noexcept {
+#if defined(EXPECTED_SCAN_X86)
+  static const scan_isa isa =
+      __builtin_cpu_supports("avx2") ? scan_isa::avx2 : scan_isa::sse2;
+  return isa;
+#else
+  return scan_isa::scalar;
+#endif
+}
+
+// A strided array of has_value flags: flag i is base[i * stride + offset].
+struct flag_array {
+  const unsigned char *base;
+  size_t size;
+  size_t stride;
+  size_t offset;
+
+  bool operator[](size_t i) const noexcept {
+    return base[i * stride + offset] != 0;
+  }
+};
+
+inline size_t scan_count_errors_scalar(const flag_array &flags,
+                                       size_t i = 0) noexcept {
+  size_t count = 0;
+  for (; i < flags.size; ++i) {
+    count += !flags[i];
+  }
+  return count;
+}
+
+inline size_t scan_find_scalar(const flag_array &flags, bool value,
+                               size_t i = 0) noexcept {
+  for (; i < flags.size; ++i) {
+    if (flags[i] == value) {
+      return i;
+    }
+  }
+  return flags.size;
+}
+
+constexpr bool scan_fits_block(size_t stride, size_t block) noexcept {
+  return stride != 0 && stride <= block && (stride & (stride - 1)) == 0;
+}
+
+// Bits of a movemask that hold a flag when stride divides the block.
+constexpr uint32_t scan_block_pattern(size_t stride, size_t offset,
+                                      size_t block) noexcept {
+  uint32_t pattern = 0;
+  for (size_t bit = offset; bit < block; bit += stride) {
+    pattern |= uint32_t(1) << bit;
+  }
+  return pattern;
+}
+
+#if defined(EXPECTED_SCAN_X86)
+
+// Each 16 byte load covers 16 / stride flags; bytes equal to zero that fall on
+// a flag position are errors. SSE2 has no popcnt, so the hits are summed per
+// byte lane and folded with psadbw before a lane can overflow.
+inline __m128i scan_block_lanes_sse2(size_t stride, size_t offset) noexcept {
+  alignas(16) unsigned char lanes[16] = {};
+  for (size_t b = offset; b < 16; b += stride) {
+    lanes[b] = 1;
+  }
+  return _mm_load_si128(reinterpret_cast<const __m128i *>(lanes));
+}
+
+inline size_t scan_count_errors_sse2(const flag_array &flags) noexcept {
+  if (!scan_fits_block(flags.stride, 16)) {
+    return scan_count_errors_scalar(flags);
+  }
+  const size_t per_block = 16 / flags.stride;
+  const __m128i lanes = scan_block_lanes_sse2(flags.stride, flags.offset);
+  const __m128i zero = _mm_setzero_si128();
+  const unsigned char *p = flags.base;
+  __m128i total = zero;
+  size_t i = 0;
+  while (i + per_block <= flags.size) {
+    __m128i acc = zero;
+    for (int round = 0; round < 255 && i + per_block <= flags.size;
+         ++round, i += per_block, p += 16) {
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+      acc = _mm_add_epi8(acc, _mm_and_si128(_mm_cmpeq_epi8(v, zero), lanes));
+    }
+    total = _mm_add_epi64(total, _mm_sad_epu8(acc, zero));
+  }
+  const size_t count =
+      static_cast<size_t>(_mm_cvtsi128_si64(total)) +
+      static_cast<size_t>(_mm_cvtsi128_si64(_mm_unpackhi_epi64(total, total)));
+  return count + scan_count_errors_scalar(flags, i);
+}
+
+inline size_t scan_find_sse2(const flag_array &flags, bool value) noexcept {
+  if (!scan_fits_block(flags.stride, 16)) {
+    return scan_find_scalar(flags, value);
+  }
+  const size_t per_block = 16 / flags.stride;
+  const uint32_t pattern = scan_block_pattern(flags.stride, flags.offset, 16);
+  const uint32_t invert = value ? pattern : 0;
+  const __m128i zero = _mm_setzero_si128();
+  const unsigned char *p = flags.base;
+  size_t i = 0;
+  for (; i + per_block <= flags.size; i += per_block, p += 16) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    const uint32_t mask =
+        (static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero))) ^
+         invert) &
+        pattern;
+    if (mask != 0) {
+      return i + (static_cast<size_t>(__builtin_ctz(mask)) - flags.offset) /
+                     flags.stride;
+    }
+  }
+  return scan_find_scalar(flags, value, i);
+}
+
+// Strides that don't divide 32 bytes are read with a gather of the 4 bytes
+// starting at each flag, which must not run past the element.
+inline bool scan_can_gather(const flag_array &flags) noexcept {
+  return flags.offset + 4 <= flags.stride &&
+         flags.stride <= size_t(INT32_MAX / 8);
+}
+
+__attribute__((target("avx2"))) inline uint32_t
+scan_gather_errors_avx2(const unsigned char *p, __m256i index) noexcept {
+  const __m256i low = _mm256_set1_epi32(0xff);
+  const __m256i g = _mm256_i32gather_epi32(reinterpret_cast<const int *>(p),
+                                           index, 1);
+  const __m256i e = _mm256_cmpeq_epi32(_mm256_and_si256(g, low),
+                                       _mm256_setzero_si256());
+  return static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(e)));
+}
+
+__attribute__((target("avx2"))) inline __m256i
+scan_gather_index_avx2(const flag_array &flags) noexcept {
+  const int s = static_cast<int>(flags.stride);
+  return _mm256_add_epi32(
+      _mm256_setr_epi32(0, s, 2 * s, 3 * s, 4 * s, 5 * s, 6 * s, 7 * s),
+      _mm256_set1_epi32(static_cast<int>(flags.offset)));
+}
+
+__attribute__((target("avx2,popcnt"))) inline size_t
+scan_count_errors_avx2(const flag_array &flags) noexcept {
+  const unsigned char *p = flags.base;
+  size_t count = 0;
+  size_t i = 0;
+  if (scan_fits_block(flags.stride, 32)) {
+    const size_t per_block = 32 / flags.stride;
+    const uint32_t pattern =
+        scan_block_pattern(flags.stride, flags.offset, 32);
+    const __m256i zero = _mm256_setzero_si256();
+    for (; i + per_block <= flags.size; i += per_block, p += 32) {
+      const __m256i v =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+      const uint32_t mask = static_cast<uint32_t>(
+          _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero)));
+      count += static_cast<size_t>(__builtin_popcount(mask & pattern));
+    }
+  } else if (scan_can_gather(flags)) {
+    const __m256i index = scan_gather_index_avx2(flags);
+    for (; i + 8 <= flags.size; i += 8, p += 8 * flags.stride) {
+      count += static_cast<size_t>(
+          __builtin_popcount(scan_gather_errors_avx2(p, index)));
+    }
+  }
+  return count + scan_count_errors_scalar(flags, i);
+}
+
+__attribute__((target("avx2"))) inline size_t
+scan_find_avx2(const flag_array &flags, bool value) noexcept {
+  const unsigned char *p = flags.base;
+  size_t i = 0;
+  if (scan_fits_block(flags.stride, 32)) {
+    const size_t per_block = 32 / flags.stride;
+    const uint32_t pattern =
+        scan_block_pattern(flags.stride, flags.offset, 32);
+    const uint32_t invert = value ? pattern : 0;
+    const __m256i zero = _mm256_setzero_si256();
+    for (; i + per_block <= flags.size; i += per_block, p += 32) {
+      const __m256i v =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+      const uint32_t mask = (static_cast<uint32_t>(_mm256_movemask_epi8(
+                                 _mm256_cmpeq_epi8(v, zero))) ^
+                             invert) &
+                            pattern;
+      if (mask != 0) {
+        return i + (static_cast<size_t>(__builtin_ctz(mask)) - flags.offset) /
+                       flags.stride;
+      }
+    }
+  } else if (scan_can_gather(flags)) {
+    const __m256i index = scan_gather_index_avx2(flags);
+    const uint32_t invert = value ? 0xff : 0;
+    for (; i + 8 <= flags.size; i += 8, p += 8 * flags.stride) {
+      const uint32_t mask = scan_gather_errors_avx2(p, index) ^ invert;
+      if (mask != 0) {
+        return i + static_cast<size_t>(__builtin_ctz(mask));
+      }
+    }
+  }
+  return scan_find_scalar(flags, value, i);
+}
+
+#endif
+
+inline size_t scan_count_errors(const flag_array &flags,
+                                scan_isa isa) noexcept {
+  switch (isa) {
+#if defined(EXPECTED_SCAN_X86)
+  case scan_isa::avx2:
+    return scan_count_errors_avx2(flags);
+  case scan_isa::sse2:
+    return scan_count_errors_sse2(flags);
+#endif
+  default:
+    return scan_count_errors_scalar(flags);
+  }
+}
+
+inline size_t scan_find(const flag_array &flags, bool value,
+                        scan_isa isa) noexcept {
+  switch (isa) {
+#if defined(EXPECTED_SCAN_X86)
+  case scan_isa::avx2:
+    return scan_find_avx2(flags, value);
+  case scan_isa::sse2:
+    return scan_find_sse2(flags, value);
+#endif
+  default:
+    return scan_find_scalar(flags, value);
+  }
+}
+
+template <class T, class E>
+flag_array scan_flags(const expected<T, E> *data, size_t n) noexcept {
+  static_assert(!is_void_v<T>, "T must not be void");
+  static_assert(is_trivially_copyable_v<T> && is_trivially_copyable_v<E>,
+                "T and E must be trivially copyable");
+  if (n == 0) {
+    return {nullptr, 0, sizeof(expected<T, E>), 0};
+  }
+  return {reinterpret_cast<const unsigned char *>(data), n,
+          sizeof(expected<T, E>), expected_layout<T, E>::has_val_offset(*data)};
+}
+
+template <class T, class E>
+size_t count_errors(const expected<T, E> *data, size_t n,
+                    scan_isa isa) noexcept {
+  return scan_count_errors(scan_flags(data, n), isa);
+}
+
+template <class T, class E>
+size_t first_error_index(const expected<T, E> *data, size_t n,
+                         scan_isa isa) noexcept {
+  return scan_find(scan_flags(data, n), false, isa);
+}
+
+template <class T, class E>
+size_t gather_values(const expected<T, E> *data, size_t n, T *out,
+                     scan_isa isa) noexcept {
+  const flag_array flags = scan_flags(data, n);
+  size_t count = 0;
+  size_t i = scan_find(flags, true, isa);
+  while (i < n) {
+    const size_t j = scan_find(flag_array{flags.base + i * flags.stride,
+                                          n - i, flags.stride, flags.offset},
+                               false, isa) +
+                     i;
+    for (; i < j; ++i) {
+      out[count++] = *data[i];
+    }
+    if (j == n) {
+      break;
+    }
+    i = scan_find(flag_array{flags.base + j * flags.stride, n - j,
+                             flags.stride, flags.offset},
+                  true, isa) +
+        j;
+  }
+  return count;
+}
+
+template <class C>
+using scan_container_value_t =
+    remove_cvref_t<decltype(*std::data(declval<const C &>()))>;
+
+} // namespace detail
+
+// Batch scans over contiguous arrays of expected with trivially copyable T and
+// E. They read the has_value flags directly with SSE2/AVX2 loads (or gathers
+// for strides that don't divide a vector), chosen at runtime.
+template <class T, class E>
+size_t count_errors(const expected<T, E> *data, size_t n) noexcept {
+  return detail::count_errors(data, n, detail::scan_best_isa());
+}
+
+// Returns n if every element holds a value.
+template <class T, class E>
+size_t first_error_index(const expected<T, E> *data, size_t n) noexcept {
+  return detail::first_error_index(data, n, detail::scan_best_isa());
+}
+
+template <class T, class E>
+bool all_ok(const expected<T, E> *data, size_t n) noexcept {
+  return first_error_index(data, n) == n;
+}
+
+// Copies the values, in order, to out and returns how many were written.
+template <class T, class E>
+size_t gather_values(const expected<T, E> *data, size_t n, T *out) noexcept {
+  return detail::gather_values(data, n, out, detail::scan_best_isa());
+}
+
+template <class C, enable_if_t<detail::is_expected_v<
+                       detail::scan_container_value_t<C>>> * = nullptr>
+size_t count_errors(const C &c) noexcept {
+  return count_errors(std::data(c), std::size(c));
+}
+template <class C, enable_if_t<detail::is_expected_v<
+                       detail::scan_container_value_t<C>>> * = nullptr>
+size_t first_error_index(const C &c) noexcept {
+  return first_error_index(std::data(c), std::size(c));
+}
+template <class C, enable_if_t<detail::is_expected_v<
+                       detail::scan_container_value_t<C>>> * = nullptr>
+bool all_ok(const C &c) noexcept {
+  return all_ok(std::data(c), std::size(c));
+}
+template <class C, class T,
+          enable_if_t<detail::is_expected_v<
+              detail::scan_container_value_t<C>>> * = nullptr>
+size_t gather_values(const C &c, T *out) noexcept {
+  return gather_values(std::data(c), std::size(c), out);
+}
+
+} // namespace fundamentals_v3
+} // namespace std::experimental
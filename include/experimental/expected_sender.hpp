@@ -0,0 +1,211 @@
+// SPDX-License-Identifier: CC0-1.0
+///
+// expected - An c++17 implementation of std::expected with extensions
+//
+// To the extent possible under law, the author(s) have dedicated all
+// copyright and related and neighboring rights to this software to the
+// public domain worldwide. This software is distributed without any warranty.
+//
+// You should have received a copy of the CC0 Public Domain Dedication
+// along with this software. If not, see
+// <http://creativecommons.org/publicdomain/zero/1.0/>.
+///
+
+#pragma once
+#include <exception>
+#include <experimental/expected.hpp>
+
+// Adapters between expected and P2300 style senders, using the member
+// customization points: sender.connect(receiver) returns an operation state
+// whose start() completes the receiver through set_value, set_error or
+// set_stopped. The adapters keep everything inside the operation state and
+// never allocate.
+
+namespace std::experimental {
+inline namespace fundamentals_v3 {
+
+namespace detail {
+
+template <class T, class E, class R> class expected_operation {
+  expected<T, E> m_exp;
+  R m_receiver;
+
+public:
+  template <class Exp>
+  expected_operation(Exp &&exp, R &&receiver)
+      : m_exp(forward<Exp>(exp)), m_receiver(move(receiver)) {}
+  expected_operation(const expected_operation &) = delete;
+  expected_operation &operator=(const expected_operation &) = delete;
+
+  void start() & noexcept {
+    if (!m_exp) {
+      move(m_receiver).set_error(move(m_exp).error());
+    } else if constexpr (is_void_v<T>) {
+      move(m_receiver).set_value();
+    } else {
+      move(m_receiver).set_value(move(*m_exp));
+    }
+  }
+};
+
+template <class R, class G, class = void>
+struct receiver_accepts_error : false_type {};
+template <class R, class G>
+struct receiver_accepts_error<
+    R, G, void_t<decltype(declval<R>().set_error(declval<G>()))>>
+    : true_type {};
+template <class R>
+using receiver_accepts_exception = receiver_accepts_error<R, exception_ptr>;
+
+// Building the expected can throw. The exception then goes to the
+// receiver's set_error(exception_ptr) if it has one, and otherwise out of
+// set_value or set_error. An error E cannot be built from, such as an
+// exception_ptr from upstream, is passed to the receiver's set_error as is,
+// and the receiver's environment is visible through get_env(), so stop
+// tokens and schedulers reach the sender.
+template <class T, class E, class R> class into_expected_receiver {
+  R m_receiver;
+
+  template <class... Args>
+  static constexpr bool nothrow_complete =
+      is_nothrow_constructible_v<expected<T, E>, Args...> ||
+      receiver_accepts_exception<R>::value;
+
+  template <class... Args>
+  void complete(Args &&... args) noexcept(nothrow_complete<Args...>) {
+    if constexpr (is_nothrow_constructible_v<expected<T, E>, Args...> ||
+                  !receiver_accepts_exception<R>::value) {
+      move(m_receiver).set_value(expected<T, E>(forward<Args>(args)...));
+    } else {
+      try {
+        move(m_receiver).set_value(expected<T, E>(forward<Args>(args)...));
+      } catch (...) {
+        move(m_receiver).set_error(current_exception());
+      }
+    }
+  }
+
+  template <class G> static constexpr bool nothrow_error() {
+    if constexpr (is_constructible_v<E, G>) {
+      return nothrow_complete<unexpect_t, G>;
+    } else if constexpr (receiver_accepts_error<R, G>::value) {
+      return noexcept(declval<R>().set_error(declval<G>()));
+    } else {
+      return false;
+    }
+  }
+
+public:
+  explicit into_expected_receiver(R &&receiver) : m_receiver(move(receiver)) {}
+
+  template <class... Args>
+  void set_value(Args &&... args) && noexcept(
+      nothrow_complete<in_place_t, Args...>) {
+    if constexpr (is_void_v<T>) {
+      static_assert(sizeof...(Args) == 0, "sender must not send a value");
+      complete();
+    } else {
+      complete(in_place, forward<Args>(args)...);
+    }
+  }
+  template <class G>
+  void set_error(G &&error) && noexcept(nothrow_error<G>()) {
+    if constexpr (is_constructible_v<E, G>) {
+      complete(unexpect, forward<G>(error));
+    } else {
+      static_assert(receiver_accepts_error<R, G>::value,
+                    "the error must convert to E or be accepted downstream");
+      move(m_receiver).set_error(forward<G>(error));
+    }
+  }
+  void set_stopped() && noexcept { move(m_receiver).set_stopped(); }
+
+  template <class Receiver = R,
+            class = decltype(declval<const Receiver &>().get_env())>
+  decltype(auto) get_env() const
+      noexcept(noexcept(declval<const Receiver &>().get_env())) {
+    return m_receiver.get_env();
+  }
+};
+
+template <class S, class = void> struct sender_expected_types {};
+template <class S>
+struct sender_expected_types<
+    S, void_t<typename S::value_type, typename S::error_type>> {
+  using value_type = typename S::value_type;
+  using error_type = typename S::error_type;
+};
+
+} // namespace detail
+
+// Completes with set_value(value), or set_value() for void, or with
+// set_error(error); start() never throws.
+template <class T, class E> class expected_sender {
+  expected<T, E> m_exp;
+
+public:
+  using value_type = T;
+  using error_type = E;
+
+  explicit expected_sender(expected<T, E> exp) : m_exp(move(exp)) {}
+
+  template <class R>
+  detail::expected_operation<T, E, detail::remove_cvref_t<R>>
+  connect(R &&receiver) && {
+    return {move(m_exp), detail::remove_cvref_t<R>(forward<R>(receiver))};
+  }
+  template <class R>
+  detail::expected_operation<T, E, detail::remove_cvref_t<R>>
+  connect(R &&receiver) const & {
+    return {m_exp, detail::remove_cvref_t<R>(forward<R>(receiver))};
+  }
+};
+
+// Folds the value and error completions of a sender into one
+// set_value(expected<T, E>); set_stopped, errors that are not convertible to
+// E and the receiver's get_env() are passed through.
+template <class S, class T, class E> class into_expected_sender {
+  S m_sender;
+
+public:
+  using value_type = expected<T, E>;
+
+  explicit into_expected_sender(S sender) : m_sender(move(sender)) {}
+
+  template <class R> auto connect(R &&receiver) && {
+    using receiver_type = detail::remove_cvref_t<R>;
+    return move(m_sender).connect(
+        detail::into_expected_receiver<T, E, receiver_type>(
+            receiver_type(forward<R>(receiver))));
+  }
+  template <class R> auto connect(R &&receiver) const & {
+    using receiver_type = detail::remove_cvref_t<R>;
+    return m_sender.connect(detail::into_expected_receiver<T, E, receiver_type>(
+        receiver_type(forward<R>(receiver))));
+  }
+};
+
+template <class T, class E>
+expected_sender<T, E> from_expected(expected<T, E> exp) {
+  return expected_sender<T, E>(move(exp));
+}
+
+// T and E default to the sender's value_type and error_type, if it has them.
+template <class T, class E, class S>
+into_expected_sender<detail::remove_cvref_t<S>, T, E>
+into_expected(S &&sender) {
+  return into_expected_sender<detail::remove_cvref_t<S>, T, E>(
+      forward<S>(sender));
+}
+template <class S, class Types = detail::sender_expected_types<
+                       detail::remove_cvref_t<S>>>
+into_expected_sender<detail::remove_cvref_t<S>, typename Types::value_type,
+                     typename Types::error_type>
+into_expected(S &&sender) {
+  return into_expected_sender<detail::remove_cvref_t<S>,
+                              typename Types::value_type,
+                              typename Types::error_type>(forward<S>(sender));
+}
+
+} // namespace fundamentals_v3
+} // namespace std::experimental
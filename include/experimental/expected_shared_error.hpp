@@ -0,0 +1,178 @@
+// SPDX-License-Identifier: CC0-1.0
+///
+// expected - An c++17 implementation of std::expected with extensions
+//
+// To the extent possible under law, the author(s) have dedicated all
+// copyright and related and neighboring rights to this software to the
+// public domain worldwide. This software is distributed without any warranty.
+//
+// You should have received a copy of the CC0 Public Domain Dedication
+// along with this software. If not, see
+// <http://creativecommons.org/publicdomain/zero/1.0/>.
+///
+
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <experimental/expected.hpp>
+
+namespace std::experimental {
+inline namespace fundamentals_v3 {
+
+// local counts with plain integers, for errors that never leave their thread.
+enum class refcount_policy { atomic, local };
+
+namespace detail {
+
+template <refcount_policy Policy> class shared_error_count;
+
+template <> class shared_error_count<refcount_policy::atomic> {
+  atomic<size_t> m_count{1};
+
+public:
+  void acquire() noexcept { m_count.fetch_add(1, memory_order_relaxed); }
+  // True when the last reference was released.
+  bool release() noexcept {
+    return m_count.fetch_sub(1, memory_order_acq_rel) == 1;
+  }
+  size_t count() const noexcept { return m_count.load(memory_order_acquire); }
+};
+
+template <> class shared_error_count<refcount_policy::local> {
+  size_t m_count = 1;
+
+public:
+  void acquire() noexcept { ++m_count; }
+  bool release() noexcept { return --m_count == 0; }
+  size_t count() const noexcept { return m_count; }
+};
+
+} // namespace detail
+
+// An immutable, reference counted E. The count lives in the same allocation
+// as the error, so copying a shared_error, which expected does whenever an
+// error is propagated from an lvalue, only bumps the count, whatever the
+// size of E. mutate() copies the error first if it is shared.
+//
+// Moving steals the reference, so a move costs no atomic operation. A
+// moved-from shared_error holds no error: it may be assigned to, destroyed,
+// compared (it equals only another moved-from one) and asked for use_count(),
+// which is 0. Accessing its error is a precondition violation and asserts.
+template <class E, refcount_policy Policy = refcount_policy::atomic>
+class shared_error {
+  struct node {
+    detail::shared_error_count<Policy> m_count;
+    E m_error;
+
+    template <class... Args>
+    explicit node(Args &&...args) : m_error(forward<Args>(args)...) {}
+  };
+
+  node *m_node;
+
+  void release() noexcept {
+    if (m_node && m_node->m_count.release()) {
+      delete m_node;
+    }
+  }
+
+public:
+  using error_type = E;
+
+  template <class... Args,
+            enable_if_t<is_constructible_v<E, Args...>> * = nullptr>
+  explicit shared_error(in_place_t, Args &&...args)
+      : m_node(new node(forward<Args>(args)...)) {}
+  shared_error(const E &error) : m_node(new node(error)) {}
+  shared_error(E &&error) : m_node(new node(move(error))) {}
+
+  shared_error(const shared_error &other) noexcept : m_node(other.m_node) {
+    if (m_node) {
+      m_node->m_count.acquire();
+    }
+  }
+  shared_error(shared_error &&other) noexcept
+      : m_node(exchange(other.m_node, nullptr)) {}
+  shared_error &operator=(const shared_error &other) noexcept {
+    if (other.m_node) {
+      other.m_node->m_count.acquire();
+    }
+    release();
+    m_node = other.m_node;
+    return *this;
+  }
+  shared_error &operator=(shared_error &&other) noexcept {
+    if (this != &other) {
+      release();
+      m_node = exchange(other.m_node, nullptr);
+    }
+    return *this;
+  }
+  ~shared_error() { release(); }
+
+  const E &error() const noexcept {
+    assert(m_node && "shared_error was moved from");
+    return m_node->m_error;
+  }
+  const E &operator*() const noexcept { return error(); }
+  const E *operator->() const noexcept { return &error(); }
+
+  size_t use_count() const noexcept {
+    return m_node ? m_node->m_count.count() : 0;
+  }
+
+  // The error for writing, copied first unless this is the only reference.
+  E &mutate() {
+    assert(m_node && "shared_error was moved from");
+    if (m_node->m_count.count() != 1) {
+      node *copy = new node(as_const(m_node->m_error));
+      release();
+      m_node = copy;
+    }
+    return m_node->m_error;
+  }
+};
+
+template <class E, refcount_policy P>
+bool operator==(const shared_error<E, P> &x, const shared_error<E, P> &y) {
+  if (!x.use_count() || !y.use_count()) {
+    return !x.use_count() && !y.use_count();
+  }
+  return &x.error() == &y.error() || x.error() == y.error();
+}
+template <class E, refcount_policy P>
+bool operator!=(const shared_error<E, P> &x, const shared_error<E, P> &y) {
+  return !(x == y);
+}
+
+template <class E, refcount_policy Policy = refcount_policy::atomic,
+          class... Args>
+unexpected<shared_error<E, Policy>> make_shared_unexpected(Args &&...args) {
+  return unexpected<shared_error<E, Policy>>(in_place, in_place,
+                                             forward<Args>(args)...);
+}
+
+namespace detail {
+
+template <class F> class update_error_fn {
+  F m_f;
+
+public:
+  explicit update_error_fn(F f) : m_f(move(f)) {}
+  template <class E, refcount_policy P>
+  shared_error<E, P> operator()(shared_error<E, P> error) const {
+    invoke(m_f, error.mutate());
+    return error;
+  }
+};
+
+} // namespace detail
+
+// For map_error: f(E&) edits the error in place when it is not shared, as
+// when map_error is called on an rvalue, and edits a copy otherwise.
+template <class F> detail::update_error_fn<decay_t<F>> update_error(F &&f) {
+  return detail::update_error_fn<decay_t<F>>(forward<F>(f));
+}
+
+} // namespace fundamentals_v3
+} // namespace std::experimental
@@ -0,0 +1,581 @@
+// SPDX-License-Identifier: CC0-1.0
+///
+// expected - An c++17 implementation of std::expected with extensions
+//
+// To the extent possible under law, the author(s) have dedicated all
+// copyright and related and neighboring rights to this software to the
+// public domain worldwide. This software is distributed without any warranty.
+//
+// You should have received a copy of the CC0 Public Domain Dedication
+// along with this software. If not, see
+// <http://creativecommons.org/publicdomain/zero/1.0/>.
+///
+
+#pragma once
+#include <experimental/expected.hpp>
+#include <experimental/expected_future.hpp>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <atomic>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <new>
+#include <optional>
+#include <thread>
+
+namespace std::experimental {
+inline namespace fundamentals_v3 {
+
+// Recycles coroutine frames by size class. Frames of tasks created while a
+// pool is current on the thread come from it, and every task started from
+// such a task inherits it, so one pool serves a whole task tree. A pool is
+// not thread safe: it belongs to the thread that made it, is only made
+// current there, and frames freed on other threads go back to operator
+// delete. It must outlive the frames it handed out.
+class frame_pool {
+  struct free_block {
+    free_block *m_next;
+  };
+
+  static constexpr size_t granularity = 64;
+  static constexpr size_t classes = 32;
+
+  free_block *m_free[classes] = {};
+  size_t m_allocations = 0;
+  thread::id m_owner = this_thread::get_id();
+
+  static constexpr size_t size_class(size_t size) noexcept {
+    return (size + granularity - 1) / granularity - 1;
+  }
+
+public:
+  frame_pool() = default;
+  frame_pool(const frame_pool &) = delete;
+  frame_pool &operator=(const frame_pool &) = delete;
+  ~frame_pool() {
+    for (free_block *head : m_free) {
+      while (head) {
+        ::operator delete(exchange(head, head->m_next));
+      }
+    }
+  }
+
+  void *allocate(size_t size) {
+    const size_t c = size_class(size);
+    if (c >= classes) {
+      return ::operator new(size);
+    }
+    if (free_block *block = m_free[c]) {
+      m_free[c] = block->m_next;
+      return block;
+    }
+    ++m_allocations;
+    return ::operator new((c + 1) * granularity);
+  }
+  void deallocate(void *p, size_t size) noexcept {
+    const size_t c = size_class(size);
+    if (c >= classes || !owned()) {
+      ::operator delete(p);
+      return;
+    }
+    m_free[c] = new (p) free_block{m_free[c]};
+  }
+
+  // Blocks obtained from operator new so far, for size classes the pool
+  // keeps.
+  size_t allocations() const noexcept { return m_allocations; }
+
+  // Whether the calling thread is the one the pool belongs to.
+  bool owned() const noexcept { return m_owner == this_thread::get_id(); }
+
+  static frame_pool *&current() noexcept {
+    static thread_local frame_pool *pool = nullptr;
+    return pool;
+  }
+
+  // Makes a pool current for the lifetime of the scope. A pool owned by
+  // another thread is not made current; null is used instead.
+  class scope {
+    frame_pool *m_prev;
+
+  public:
+    explicit scope(frame_pool *pool) noexcept
+        : m_prev(exchange(current(), pool && pool->owned() ? pool : nullptr)) {
+    }
+    scope(const scope &) = delete;
+    scope &operator=(const scope &) = delete;
+    ~scope() { current() = m_prev; }
+  };
+};
+
+template <class T, class E> class task;
+
+namespace detail {
+
+struct task_frame_trailer {
+  frame_pool *m_pool;
+};
+
+constexpr size_t task_trailer_offset(size_t size) noexcept {
+  constexpr size_t align = alignof(task_frame_trailer);
+  return (size + align - 1) & ~(align - 1);
+}
+
+struct task_promise_base {
+  coroutine_handle<> m_continuation;
+  // Set when the awaiting task wants errors propagated: m_propagate moves an
+  // error into m_parent and reports whether there was one.
+  task_promise_base *m_parent = nullptr;
+  bool (*m_propagate)(task_promise_base &, task_promise_base &) = nullptr;
+  atomic<uint32_t> *m_signal = nullptr;
+  frame_pool *m_pool = frame_pool::current();
+  // The pool that was current on the resuming thread, put back on suspend.
+  frame_pool *m_resumer_pool = nullptr;
+  exception_ptr m_exception;
+  // While this task is suspended on a child task: the child's promise, and
+  // the task object in this frame that owns it with the function that takes
+  // its handle. The child links back through m_awaiter.
+  task_promise_base *m_child = nullptr;
+  task_promise_base *m_awaiter = nullptr;
+  void *m_child_owner = nullptr;
+  coroutine_handle<> (*m_release_child)(void *) noexcept = nullptr;
+
+  static void *operator new(size_t size) {
+    frame_pool *pool = frame_pool::current();
+    const size_t total =
+        task_trailer_offset(size) + sizeof(task_frame_trailer);
+    void *frame = pool ? pool->allocate(total) : ::operator new(total);
+    new (static_cast<unsigned char *>(frame) + task_trailer_offset(size))
+        task_frame_trailer{pool};
+    return frame;
+  }
+  static void operator delete(void *frame, size_t size) noexcept {
+    frame_pool *pool =
+        reinterpret_cast<task_frame_trailer *>(
+            static_cast<unsigned char *>(frame) + task_trailer_offset(size))
+            ->m_pool;
+    if (pool) {
+      pool->deallocate(frame,
+                       task_trailer_offset(size) + sizeof(task_frame_trailer));
+    } else {
+      ::operator delete(frame);
+    }
+  }
+
+  // Where control goes once this task has its result. An error that is being
+  // propagated completes the awaiting task too, without resuming it.
+  coroutine_handle<> complete() noexcept {
+    task_promise_base *p = this;
+    while (p->m_parent && p->m_propagate(*p, *p->m_parent)) {
+      p = p->m_parent;
+    }
+    const coroutine_handle<> next = p->m_continuation;
+    if (atomic<uint32_t> *signal = p->m_signal) {
+      signal->store(1, memory_order_release);
+      detail::atomic_notify_all(*signal);
+    }
+    return next ? next : noop_coroutine();
+  }
+
+  // Every resume is paired with a suspend on the same thread, so the
+  // resuming thread gets its own pool back. Off the pool's thread the task
+  // allocates from operator new instead.
+  void resumed() noexcept {
+    m_resumer_pool = exchange(frame_pool::current(),
+                              m_pool && m_pool->owned() ? m_pool : nullptr);
+  }
+  void suspended() noexcept { frame_pool::current() = m_resumer_pool; }
+};
+
+// A propagated error leaves every task between the failing one and the one
+// it completed suspended on its child, each owning the next. Destroying the
+// outermost frame would destroy the rest recursively, one stack level per
+// task, so the chain is torn down innermost first: each frame's owner is
+// released before its parent, whose destruction then finds nothing to do.
+inline void destroy_task_chain(task_promise_base &root,
+                               coroutine_handle<> frame) noexcept {
+  task_promise_base *p = &root;
+  while (p->m_child) {
+    p = p->m_child;
+  }
+  while (p != &root) {
+    task_promise_base *const parent = p->m_awaiter;
+    const coroutine_handle<> child =
+        parent->m_release_child(parent->m_child_owner);
+    parent->m_child = nullptr;
+    child.destroy();
+    p = parent;
+  }
+  frame.destroy();
+}
+
+template <class T, class E> class task_promise;
+
+template <class T, class E> struct task_final_awaiter {
+  bool await_ready() const noexcept { return false; }
+  coroutine_handle<>
+  await_suspend(coroutine_handle<task_promise<T, E>> handle) noexcept {
+    handle.promise().suspended();
+    return handle.promise().complete();
+  }
+  void await_resume() const noexcept {}
+};
+
+struct task_initial_awaiter {
+  task_promise_base *m_promise;
+
+  bool await_ready() const noexcept { return false; }
+  void await_suspend(coroutine_handle<>) const noexcept {}
+  void await_resume() const noexcept { m_promise->resumed(); }
+};
+
+// Wraps any other awaitable so the resuming thread's pool is restored while
+// the task is suspended and the task's pool is current again on resume.
+template <class Awaitable> struct task_resume_awaiter {
+  Awaitable m_awaitable;
+  task_promise_base *m_promise;
+
+  bool await_ready() { return m_awaitable.await_ready(); }
+  // The handle may be resumed elsewhere as soon as it is passed on, so the
+  // pool is restored first.
+  template <class Promise>
+  decltype(auto) await_suspend(coroutine_handle<Promise> handle) {
+    m_promise->suspended();
+    return m_awaitable.await_suspend(handle);
+  }
+  decltype(auto) await_resume() {
+    m_promise->resumed();
+    return m_awaitable.await_resume();
+  }
+};
+
+template <class T, class E> struct task_as_expected {
+  task<T, E> &m_task;
+};
+
+struct task_access {
+  template <class T, class E>
+  static coroutine_handle<task_promise<T, E>> handle(task<T, E> &t) noexcept {
+    return t.m_handle;
+  }
+  template <class T, class E>
+  static coroutine_handle<> release(void *owner) noexcept {
+    return exchange(static_cast<task<T, E> *>(owner)->m_handle, nullptr);
+  }
+};
+
+template <class T> struct is_task : false_type {};
+template <class T, class E> struct is_task<task<T, E>> : true_type {};
+template <class T, class E>
+struct is_task<task_as_expected<T, E>> : true_type {};
+
+template <class Child, class Parent>
+bool task_propagate_error(task_promise_base &child,
+                          task_promise_base &parent) {
+  auto &result = static_cast<Child &>(child).m_result;
+  if (!result || result->has_value()) {
+    return false;
+  }
+  static_cast<Parent &>(parent).set_result(unexpect, move(result->error()));
+  return true;
+}
+
+// Starts the child by symmetric transfer. With Propagate the child's error
+// completes the parent directly and only the value is returned; otherwise
+// the whole expected is.
+template <class T, class E, class Parent, bool Propagate> class task_awaiter {
+  task<T, E> *m_owner;
+  coroutine_handle<task_promise<T, E>> m_child;
+  Parent *m_parent;
+
+public:
+  task_awaiter(task<T, E> &owner, Parent *parent) noexcept
+      : m_owner(addressof(owner)), m_child(task_access::handle(owner)),
+        m_parent(parent) {}
+
+  bool await_ready() const noexcept { return false; }
+  coroutine_handle<> await_suspend(coroutine_handle<> handle) noexcept {
+    m_parent->suspended();
+    task_promise<T, E> &child = m_child.promise();
+    child.m_continuation = handle;
+    child.m_awaiter = m_parent;
+    m_parent->m_child = addressof(child);
+    m_parent->m_child_owner = m_owner;
+    m_parent->m_release_child = &task_access::release<T, E>;
+    if constexpr (Propagate) {
+      child.m_parent = m_parent;
+      child.m_propagate = &task_propagate_error<task_promise<T, E>, Parent>;
+    }
+    return m_child;
+  }
+  decltype(auto) await_resume() {
+    m_parent->resumed();
+    m_parent->m_child = nullptr;
+    task_promise<T, E> &child = m_child.promise();
+    if (child.m_exception) {
+      rethrow_exception(child.m_exception);
+    }
+    if constexpr (!Propagate) {
+      return move(*child.m_result);
+    } else if constexpr (!is_void_v<T>) {
+      return move(**child.m_result);
+    }
+  }
+};
+
+template <class T, class E>
+class task_promise_common : public task_promise_base {
+public:
+  optional<expected<T, E>> m_result;
+
+  template <class... Args> void set_result(Args &&... args) {
+    m_result.emplace(forward<Args>(args)...);
+  }
+
+  task<T, E> get_return_object() noexcept {
+    return task<T, E>(coroutine_handle<task_promise<T, E>>::from_promise(
+        static_cast<task_promise<T, E> &>(*this)));
+  }
+  task_initial_awaiter initial_suspend() noexcept { return {this}; }
+  task_final_awaiter<T, E> final_suspend() const noexcept { return {}; }
+  // Rethrown where the task is awaited.
+  void unhandled_exception() noexcept { m_exception = current_exception(); }
+
+  // co_await on a task yields its value and propagates its error;
+  // as_expected() yields the expected instead.
+  template <class U, class G>
+  task_awaiter<U, G, task_promise<T, E>, true>
+  await_transform(task<U, G> &t) noexcept {
+    static_assert(is_constructible_v<E, G &&>,
+                  "the awaited error must convert to E");
+    return {t, static_cast<task_promise<T, E> *>(this)};
+  }
+  template <class U, class G>
+  task_awaiter<U, G, task_promise<T, E>, true>
+  await_transform(task<U, G> &&t) noexcept {
+    return await_transform(t);
+  }
+  template <class U, class G>
+  task_awaiter<U, G, task_promise<T, E>, false>
+  await_transform(task_as_expected<U, G> t) noexcept {
+    return {t.m_task, static_cast<task_promise<T, E> *>(this)};
+  }
+
+  // co_await on an expected yields its value or completes the task with its
+  // error, as does co_await unexpected(e).
+  template <class Exp> class expected_awaiter {
+    Exp &&m_exp;
+    task_promise_common *m_promise;
+
+  public:
+    expected_awaiter(Exp &&exp, task_promise_common *promise) noexcept
+        : m_exp(forward<Exp>(exp)), m_promise(promise) {}
+
+    bool await_ready() const noexcept { return m_exp.has_value(); }
+    coroutine_handle<> await_suspend(coroutine_handle<>) {
+      m_promise->set_result(unexpect, forward<Exp>(m_exp).error());
+      m_promise->suspended();
+      return m_promise->complete();
+    }
+    decltype(auto) await_resume() const noexcept {
+      if constexpr (!is_void_v<typename remove_cvref_t<Exp>::value_type>) {
+        return *forward<Exp>(m_exp);
+      }
+    }
+  };
+  template <class Exp,
+            enable_if_t<is_expected_v<remove_cvref_t<Exp>>> * = nullptr>
+  expected_awaiter<Exp> await_transform(Exp &&exp) noexcept {
+    return {forward<Exp>(exp), this};
+  }
+  template <class G> class unexpected_awaiter {
+    unexpected<G> &&m_unex;
+    task_promise_common *m_promise;
+
+  public:
+    unexpected_awaiter(unexpected<G> &&unex,
+                       task_promise_common *promise) noexcept
+        : m_unex(move(unex)), m_promise(promise) {}
+
+    bool await_ready() const noexcept { return false; }
+    coroutine_handle<> await_suspend(coroutine_handle<>) {
+      m_promise->set_result(unexpect, move(m_unex).value());
+      m_promise->suspended();
+      return m_promise->complete();
+    }
+    void await_resume() const noexcept {}
+  };
+  template <class G>
+  unexpected_awaiter<G> await_transform(unexpected<G> &&unex) noexcept {
+    return {move(unex), this};
+  }
+
+  template <class Awaitable,
+            enable_if_t<!is_expected_v<remove_cvref_t<Awaitable>> &&
+                        !is_task<remove_cvref_t<Awaitable>>::value> * =
+                nullptr>
+  task_resume_awaiter<Awaitable> await_transform(Awaitable &&awaitable) {
+    return {forward<Awaitable>(awaitable), this};
+  }
+};
+
+template <class T, class E>
+class task_promise : public task_promise_common<T, E> {
+public:
+  template <class U = T> void return_value(U &&value) {
+    this->set_result(forward<U>(value));
+  }
+};
+
+template <class E>
+class task_promise<void, E> : public task_promise_common<void, E> {
+public:
+  void return_void() { this->set_result(); }
+};
+
+} // namespace detail
+
+// A lazily started coroutine producing expected<T, E>. Awaiting another task
+// from inside a task transfers control symmetrically, so chains of any depth
+// run and are destroyed in constant stack; the child's error completes the
+// awaiting task as well unless it was awaited through as_expected().
+template <class T, class E> class task {
+  using handle_type = coroutine_handle<detail::task_promise<T, E>>;
+  handle_type m_handle;
+
+  template <class U, class G> friend class detail::task_promise_common;
+  friend class run_loop;
+  friend struct detail::task_access;
+
+  explicit task(handle_type handle) noexcept : m_handle(handle) {}
+
+  // Runs the task on this thread until it finishes or first suspends; done
+  // is set once it has a result.
+  void start(atomic<uint32_t> &done) {
+    m_handle.promise().m_signal = addressof(done);
+    frame_pool::scope scope(frame_pool::current());
+    m_handle.resume();
+  }
+  expected<T, E> result() {
+    auto &promise = m_handle.promise();
+    if (promise.m_exception) {
+      rethrow_exception(promise.m_exception);
+    }
+    return move(*promise.m_result);
+  }
+
+  template <class U, class G> friend expected<U, G> sync_wait(task<U, G>);
+
+public:
+  using promise_type = detail::task_promise<T, E>;
+  using value_type = T;
+  using error_type = E;
+
+  task(task &&rhs) noexcept : m_handle(exchange(rhs.m_handle, nullptr)) {}
+  task &operator=(task &&rhs) noexcept {
+    task(move(rhs)).swap(*this);
+    return *this;
+  }
+  ~task() {
+    if (m_handle) {
+      detail::destroy_task_chain(m_handle.promise(), m_handle);
+    }
+  }
+
+  void swap(task &rhs) noexcept {
+    using std::swap;
+    swap(m_handle, rhs.m_handle);
+  }
+
+  detail::task_as_expected<T, E> as_expected() & noexcept { return {*this}; }
+  detail::task_as_expected<T, E> as_expected() && noexcept { return {*this}; }
+};
+
+// Runs the task on this thread until it finishes or suspends, then blocks
+// until another thread completes it.
+template <class T, class E> expected<T, E> sync_wait(task<T, E> t) {
+  atomic<uint32_t> done{0};
+  t.start(done);
+  while (done.load(memory_order_acquire) == 0) {
+    detail::atomic_wait(done, 0);
+  }
+  return t.result();
+}
+
+namespace detail {
+
+// Runs a task to completion from a coroutine that is not itself a task and
+// yields a reference to its result. Exceptions are not forwarded.
+template <class T, class E> class task_run_awaiter {
+  coroutine_handle<task_promise<T, E>> m_handle;
+
+public:
+  explicit task_run_awaiter(task<T, E> &t) noexcept
+      : m_handle(task_access::handle(t)) {}
+
+  bool await_ready() const noexcept { return false; }
+  coroutine_handle<> await_suspend(coroutine_handle<> handle) noexcept {
+    m_handle.promise().m_continuation = handle;
+    return m_handle;
+  }
+  expected<T, E> *await_resume() const noexcept {
+    auto &result = m_handle.promise().m_result;
+    return result ? addressof(*result) : nullptr;
+  }
+};
+
+} // namespace detail
+
+// A single threaded scheduler: co_await loop.schedule() queues the task and
+// run() resumes queued tasks until there are none left.
+class run_loop {
+  deque<coroutine_handle<>> m_queue;
+
+public:
+  class schedule_awaiter {
+    run_loop *m_loop;
+
+  public:
+    explicit schedule_awaiter(run_loop *loop) noexcept : m_loop(loop) {}
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(coroutine_handle<> handle) {
+      m_loop->m_queue.push_back(handle);
+    }
+    void await_resume() const noexcept {}
+  };
+
+  schedule_awaiter schedule() noexcept { return schedule_awaiter(this); }
+
+  bool run_one() {
+    if (m_queue.empty()) {
+      return false;
+    }
+    const coroutine_handle<> handle = m_queue.front();
+    m_queue.pop_front();
+    frame_pool::scope scope(frame_pool::current());
+    handle.resume();
+    return true;
+  }
+  void run() {
+    while (run_one()) {
+    }
+  }
+
+  // Starts the task and runs the loop until the task is done.
+  template <class T, class E> expected<T, E> sync_wait(task<T, E> t) {
+    atomic<uint32_t> done{0};
+    t.start(done);
+    while (done.load(memory_order_acquire) == 0) {
+      if (!run_one()) {
+        detail::atomic_wait(done, 0);
+      }
+    }
+    return t.result();
+  }
+};
+
+} // namespace fundamentals_v3
+} // namespace std::experimental
+
+#endif
@@ -0,0 +1,262 @@
+// SPDX-License-Identifier: CC0-1.0
+///
+// expected - An c++17 implementation of std::expected with extensions
+//
+// To the extent possible under law, the author(s) have dedicated all
+// copyright and related and neighboring rights to this software to the
+// public domain worldwide. This software is distributed without any warranty.
+//
+// You should have received a copy of the CC0 Public Domain Dedication
+// along with this software. If not, see
+// <http://creativecommons.org/publicdomain/zero/1.0/>.
+///
+
+#pragma once
+#include <experimental/expected_cancellation.hpp>
+#include <experimental/expected_task.hpp>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace std::experimental {
+inline namespace fundamentals_v3 {
+
+// A fixed set of worker threads resuming coroutines in FIFO order. Workers
+// run without a current frame_pool, and a task from another thread's pool
+// allocates from operator new while it runs here. The destructor lets queued
+// work finish.
+class thread_pool {
+  mutex m_mutex;
+  condition_variable m_cv;
+  deque<coroutine_handle<>> m_queue;
+  bool m_stop = false;
+  vector<thread> m_threads;
+
+  void work() {
+    for (;;) {
+      unique_lock<mutex> lock(m_mutex);
+      m_cv.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+      if (m_queue.empty()) {
+        return;
+      }
+      const coroutine_handle<> handle = m_queue.front();
+      m_queue.pop_front();
+      lock.unlock();
+      frame_pool::scope scope(nullptr);
+      handle.resume();
+    }
+  }
+
+public:
+  class schedule_awaiter {
+    thread_pool *m_pool;
+
+  public:
+    explicit schedule_awaiter(thread_pool *pool) noexcept : m_pool(pool) {}
+    bool await_ready() const noexcept { return false; }
+    // The awaiter lives in the frame, which a worker may resume and free as
+    // soon as the handle is queued.
+    void await_suspend(coroutine_handle<> handle) {
+      thread_pool *pool = m_pool;
+      {
+        lock_guard<mutex> lock(pool->m_mutex);
+        pool->m_queue.push_back(handle);
+      }
+      pool->m_cv.notify_one();
+    }
+    void await_resume() const noexcept {}
+  };
+
+  explicit thread_pool(
+      size_t threads = max<size_t>(1, thread::hardware_concurrency())) {
+    m_threads.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+      m_threads.emplace_back([this] { work(); });
+    }
+  }
+  thread_pool(const thread_pool &) = delete;
+  thread_pool &operator=(const thread_pool &) = delete;
+  ~thread_pool() {
+    {
+      lock_guard<mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_cv.notify_all();
+    for (thread &t : m_threads) {
+      t.join();
+    }
+  }
+
+  size_t size() const noexcept { return m_threads.size(); }
+  schedule_awaiter schedule() noexcept { return schedule_awaiter(this); }
+};
+
+namespace detail {
+
+// A detached coroutine; its frame is freed when it finishes.
+struct when_runner {
+  struct promise_type {
+    when_runner get_return_object() const noexcept { return {}; }
+    suspend_never initial_suspend() const noexcept { return {}; }
+    suspend_never final_suspend() const noexcept { return {}; }
+    void return_void() const noexcept {}
+    void unhandled_exception() const noexcept { terminate(); }
+  };
+};
+
+// Counts finished children. The awaiting coroutine holds one extra count, so
+// whichever of it and the last child gets there last resumes it.
+class when_latch {
+  atomic<size_t> m_count;
+  coroutine_handle<> m_waiter;
+
+public:
+  explicit when_latch(size_t children) noexcept : m_count(children + 1) {}
+
+  void arrive() noexcept {
+    if (m_count.fetch_sub(1, memory_order_acq_rel) == 1) {
+      m_waiter.resume();
+    }
+  }
+
+  template <class Start> class awaiter {
+    when_latch &m_latch;
+    Start m_start;
+
+  public:
+    awaiter(when_latch &latch, Start start)
+        : m_latch(latch), m_start(move(start)) {}
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(coroutine_handle<> handle) {
+      m_latch.m_waiter = handle;
+      m_start();
+      return m_latch.m_count.fetch_sub(1, memory_order_acq_rel) != 1;
+    }
+    void await_resume() const noexcept {}
+  };
+
+  // Calls start() to launch the children and suspends until they are done.
+  template <class Start> awaiter<Start> wait(Start start) {
+    return awaiter<Start>(*this, move(start));
+  }
+};
+
+// Moves the child to the executor, runs it there and reports its result.
+template <class Executor, class T, class E, class Done>
+when_runner when_run(Executor &executor, task<T, E> &child, Done done) {
+  co_await executor.schedule();
+  expected<T, E> *result = co_await task_run_awaiter<T, E>(child);
+  if (!result) {
+    terminate();
+  }
+  done(*result);
+}
+
+inline constexpr size_t when_none = size_t(-1);
+
+} // namespace detail
+
+// Runs every task on the executor concurrently. The result holds all values,
+// or the error of the first task to fail; that failure also cancels source so
+// the other tasks can stop early. Tasks receive the token themselves (e.g. as
+// a parameter) and must not throw. Executor is anything with schedule(), such
+// as thread_pool or run_loop.
+template <class Executor, class E, class... Ts>
+task<tuple<Ts...>, E> when_all(Executor &executor, cancellation_source source,
+                               task<Ts, E>... tasks) {
+  static_assert((!is_void_v<Ts> && ...), "tasks must produce a value");
+  detail::when_latch latch(sizeof...(Ts));
+  atomic<size_t> first_failed{detail::when_none};
+
+  co_await latch.wait([&] {
+    size_t index = 0;
+    (detail::when_run(executor, tasks,
+                      [&, i = index++](auto &result) {
+                        if (!result) {
+                          size_t none = detail::when_none;
+                          if (first_failed.compare_exchange_strong(none, i)) {
+                            source.request_cancellation();
+                          }
+                        }
+                        latch.arrive();
+                      }),
+     ...);
+  });
+
+  if (const size_t failed = first_failed.load(); failed != detail::when_none) {
+    optional<E> error;
+    size_t index = 0;
+    auto take = [&](auto &t) {
+      auto &result = detail::task_access::handle(t).promise().m_result;
+      if (index++ == failed) {
+        error.emplace(move(result->error()));
+      }
+    };
+    (take(tasks), ...);
+    co_await unexpected<E>(move(*error));
+  }
+  co_return tuple<Ts...>(
+      move(**detail::task_access::handle(tasks).promise().m_result)...);
+}
+
+// Runs every task on the executor concurrently and returns the first value;
+// the first success cancels source. Only if every task fails is an error
+// returned, the one from the task that finished last.
+template <class Executor, class T, class E, class... Tasks>
+task<T, E> when_any(Executor &executor, cancellation_source source,
+                    task<T, E> first, Tasks... rest) {
+  static_assert((is_same_v<Tasks, task<T, E>> && ...),
+                "tasks must have the same type");
+  detail::when_latch latch(1 + sizeof...(Tasks));
+  atomic<size_t> winner{detail::when_none};
+  atomic<size_t> last_failed{detail::when_none};
+
+  co_await latch.wait([&] {
+    size_t index = 0;
+    auto run = [&](task<T, E> &t) {
+      detail::when_run(executor, t, [&, i = index++](auto &result) {
+        if (result) {
+          size_t none = detail::when_none;
+          if (winner.compare_exchange_strong(none, i)) {
+            source.request_cancellation();
+          }
+        } else {
+          last_failed.store(i, memory_order_relaxed);
+        }
+        latch.arrive();
+      });
+    };
+    run(first);
+    (run(rest), ...);
+  });
+
+  const size_t won = winner.load();
+  const size_t chosen = won != detail::when_none ? won : last_failed.load();
+  optional<expected<T, E>> result;
+  size_t index = 0;
+  auto take = [&](task<T, E> &t) {
+    if (index++ == chosen) {
+      result.emplace(move(*detail::task_access::handle(t).promise().m_result));
+    }
+  };
+  take(first);
+  (take(rest), ...);
+  if (!*result) {
+    co_await unexpected<E>(move(result->error()));
+  }
+  if constexpr (is_void_v<T>) {
+    co_return;
+  } else {
+    co_return move(**result);
+  }
+}
+
+} // namespace fundamentals_v3
+} // namespace std::experimental
+
+#endif
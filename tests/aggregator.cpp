@@ -0,0 +1,73 @@
+// SPDX-License-Identifier: CC0-1.0
+#include "catch.hpp"
+#include <experimental/expected_aggregator.hpp>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using std::experimental::error_aggregator;
+using std::experimental::expected;
+using std::experimental::unexpect;
+using std::experimental::unexpected;
+
+namespace {
+struct io_error {
+  int code;
+  std::string path;
+};
+
+struct by_code {
+  int operator()(const io_error &e) const { return e.code; }
+};
+} // namespace
+
+TEST_CASE("Aggregate errors", "[aggregator.basic]") {
+  error_aggregator<int> agg(2);
+  agg.record(unexpected<int>(3));
+  agg.record(expected<double, int>(unexpect, 5));
+  CHECK(agg.record(expected<double, int>(1.0)));
+  for (int i = 0; i < 3; ++i) {
+    CHECK_FALSE(agg.record(expected<void, int>(unexpect, 3)));
+  }
+  CHECK(agg.total() == 5);
+
+  auto top = agg.top_k(1);
+  REQUIRE(top.size() == 1);
+  CHECK(top[0].key == 3);
+  CHECK(top[0].count == 4);
+  CHECK(top[0].samples == std::vector<int>{3, 3});
+
+  CHECK(agg.top_k(10).size() == 2);
+  agg.clear();
+  CHECK(agg.total() == 0);
+  CHECK(agg.snapshot().empty());
+}
+
+TEST_CASE("Aggregate errors from many threads", "[aggregator.threads]") {
+  error_aggregator<io_error, by_code> agg(3, 4);
+  constexpr int threads = 8;
+  constexpr int per_thread = 1000;
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&agg, t] {
+      for (int i = 0; i < per_thread; ++i) {
+        expected<int, io_error> result(unexpect, io_error{i % 4 == 0 ? 2 : 13,
+                                                          std::to_string(t)});
+        agg.record(std::move(result));
+      }
+    });
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  CHECK(agg.total() == threads * per_thread);
+  auto top = agg.top_k(2);
+  REQUIRE(top.size() == 2);
+  CHECK(top[0].key == 13);
+  CHECK(top[0].count == threads * per_thread * 3 / 4);
+  CHECK(top[1].key == 2);
+  CHECK(top[1].count == threads * per_thread / 4);
+  CHECK(top[0].samples.size() == 3);
+  CHECK(top[0].samples[0].code == 13);
+}
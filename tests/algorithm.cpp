@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: CC0-1.0
+#include "catch.hpp"
+#include <experimental/expected_algorithm.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+
+using std::experimental::all_of_expected;
+using std::experimental::any_of_expected;
+using std::experimental::expected;
+using std::experimental::first_success;
+using std::experimental::fold_expected;
+using std::experimental::unexpect;
+
+namespace {
+struct counted_acc {
+  static inline int copies = 0;
+  std::vector<int> items;
+  counted_acc() = default;
+  counted_acc(const counted_acc &rhs) : items(rhs.items) { ++copies; }
+  counted_acc(counted_acc &&) = default;
+  counted_acc &operator=(const counted_acc &rhs) {
+    items = rhs.items;
+    ++copies;
+    return *this;
+  }
+  counted_acc &operator=(counted_acc &&) = default;
+};
+} // namespace
+
+TEST_CASE("Fold over expected", "[algorithm.fold]") {
+  const std::vector<int> v = {1, 2, 3, 4, 5};
+  auto add = [](int acc, int x) -> expected<int, std::string> {
+    return acc + x;
+  };
+  auto ret = fold_expected(v, 10, add);
+  REQUIRE(ret);
+  CHECK(*ret == 25);
+
+  int calls = 0;
+  auto stop_at_3 = [&](int acc, int x) -> expected<int, std::string> {
+    ++calls;
+    if (x == 3) {
+      return expected<int, std::string>(unexpect, "three");
+    }
+    return acc + x;
+  };
+  ret = fold_expected(v, 0, stop_at_3);
+  CHECK_FALSE(ret);
+  CHECK(ret.error() == "three");
+  CHECK(calls == 3);
+
+  CHECK(*fold_expected(std::vector<int>{}, 7, add) == 7);
+
+  counted_acc::copies = 0;
+  auto collect = [](counted_acc acc, int x) -> expected<counted_acc, int> {
+    acc.items.push_back(x);
+    return acc;
+  };
+  auto collected = fold_expected(v, counted_acc{}, collect);
+  REQUIRE(collected);
+  CHECK(collected->items == v);
+  CHECK(counted_acc::copies == 0);
+}
+
+TEST_CASE("First success", "[algorithm.first_success]") {
+  using result = expected<int, std::string>;
+  int calls = 0;
+  std::vector<std::function<result()>> thunks = {
+      [&] {
+        ++calls;
+        return result(unexpect, "a");
+      },
+      [&] {
+        ++calls;
+        return result(2);
+      },
+      [&] {
+        ++calls;
+        return result(3);
+      },
+  };
+  auto ret = first_success(thunks);
+  CHECK(*ret == 2);
+  CHECK(calls == 2);
+
+  thunks.erase(thunks.begin() + 1, thunks.end());
+  thunks.push_back([] { return result(unexpect, "b"); });
+  ret = first_success(thunks);
+  CHECK(ret.error() == "b");
+
+  thunks.clear();
+  ret = first_success(thunks);
+  CHECK_FALSE(ret);
+  CHECK(ret.error().empty());
+
+  std::vector<expected<int, int> (*)()> none;
+  CHECK(first_success(none).error() == 0);
+  CHECK(first_success(none, -1).error() == -1);
+
+  struct no_default {
+    explicit no_default(int v) : value(v) {}
+    int value;
+  };
+  std::vector<expected<int, no_default> (*)()> strict;
+  CHECK(first_success(strict, 7).error().value == 7);
+}
+
+TEST_CASE("Any and all over expected", "[algorithm.any_all]") {
+  const std::vector<int> v = {2, 4, 5, -1, 6};
+  int calls = 0;
+  auto even = [&](int x) -> expected<bool, int> {
+    ++calls;
+    if (x < 0) {
+      return expected<bool, int>(unexpect, x);
+    }
+    return x % 2 == 0;
+  };
+
+  auto all = all_of_expected(v, even);
+  REQUIRE(all);
+  CHECK_FALSE(*all);
+  CHECK(calls == 3);
+
+  calls = 0;
+  auto any = any_of_expected(v, even);
+  REQUIRE(any);
+  CHECK(*any);
+  CHECK(calls == 1);
+
+  calls = 0;
+  auto odd = [&](int x) { return even(x).map([](bool b) { return !b; }); };
+  any = any_of_expected(std::vector<int>{2, -3, 5}, odd);
+  CHECK_FALSE(any);
+  CHECK(any.error() == -3);
+  CHECK(calls == 2);
+
+  CHECK(*all_of_expected(std::vector<int>{}, even));
+  CHECK_FALSE(*any_of_expected(std::vector<int>{}, even));
+}
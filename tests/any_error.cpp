@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: CC0-1.0
+#include "catch.hpp"
+#include <array>
+#include <experimental/expected_any_error.hpp>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+using std::experimental::any_error;
+using std::experimental::error_entry;
+using std::experimental::expected;
+using std::experimental::unexpected;
+
+namespace {
+enum class net_errc { timeout, refused };
+
+struct db_error {
+  int code() const { return 1205; }
+  std::string message() const { return "deadlock"; }
+};
+
+struct big_error {
+  std::array<char, 64> bytes{};
+  std::shared_ptr<int> alive = std::make_shared<int>(1);
+};
+} // namespace
+
+template <> struct std::experimental::error_domain<net_errc> {
+  static constexpr std::string_view name = "net";
+  static constexpr error_entry entries[] = {{"timeout", "timed out"},
+                                            {"refused", "refused"}};
+};
+
+TEST_CASE("any_error payloads", "[any_error.payload]") {
+  STATIC_REQUIRE(sizeof(any_error) == 40);
+  STATIC_REQUIRE(any_error::fits_inline<std::string>);
+  STATIC_REQUIRE(any_error::fits_inline<std::error_code>);
+  STATIC_REQUIRE_FALSE(any_error::fits_inline<big_error>);
+
+  any_error empty;
+  CHECK_FALSE(empty.has_value());
+  CHECK(empty.code() == 0);
+  CHECK(empty.message().empty());
+
+  any_error net = net_errc::refused;
+  CHECK(net.holds<net_errc>());
+  CHECK(net.code() == 1);
+  CHECK(net.message() == "refused");
+
+  any_error ec = std::make_error_code(std::errc::permission_denied);
+  CHECK(ec.code() == int(std::errc::permission_denied));
+  CHECK_FALSE(ec.message().empty());
+
+  CHECK(any_error(db_error()).code() == 1205);
+  CHECK(any_error(db_error()).message() == "deadlock");
+  CHECK(any_error(std::runtime_error("disk full")).message() == "disk full");
+  CHECK(any_error(std::string("bad input")).message() == "bad input");
+  CHECK(any_error(42).code() == 42);
+
+  REQUIRE(net.target<net_errc>());
+  CHECK(*net.target<net_errc>() == net_errc::refused);
+  CHECK_FALSE(net.target<int>());
+}
+
+TEST_CASE("any_error copy and move", "[any_error.copy]") {
+  big_error big;
+  std::weak_ptr<int> watch = big.alive;
+  {
+    any_error heap = std::move(big);
+    CHECK_FALSE(watch.expired());
+    any_error copy = heap;
+    any_error moved = std::move(heap);
+    CHECK_FALSE(heap.has_value());
+    CHECK(copy.target<big_error>() != moved.target<big_error>());
+    moved = std::string("replaced");
+    CHECK(moved.message() == "replaced");
+    copy = moved;
+    CHECK(copy.message() == "replaced");
+  }
+  CHECK(watch.expired());
+
+  any_error s = std::string("kept");
+  any_error t = std::move(s);
+  CHECK(t.message() == "kept");
+}
+
+TEST_CASE("any_error in expected", "[any_error.expected]") {
+  expected<int, any_error> r = unexpected(net_errc::timeout);
+  CHECK(r.error().message() == "timed out");
+  r = unexpected(std::string("parse error"));
+  CHECK(r.error().message() == "parse error");
+
+  any_error from_unexpected = unexpected(7);
+  CHECK(from_unexpected.holds<int>());
+}
@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: CC0-1.0
+#include "catch.hpp"
+#include <cstdint>
+#include <experimental/expected_atomic.hpp>
+#include <thread>
+#include <vector>
+
+using std::experimental::atomic_expected;
+using std::experimental::expected;
+using std::experimental::unexpect;
+
+namespace {
+enum class err_enum : std::uint8_t { none, timeout, refused };
+}
+
+TEST_CASE("Atomic expected operations", "[atomic.ops]") {
+  using status = expected<std::uint32_t, err_enum>;
+  atomic_expected<std::uint32_t, err_enum> a(status(5));
+  CHECK(a.is_lock_free());
+  CHECK(*a.load() == 5);
+
+  a.store(status(unexpect, err_enum::timeout));
+  status cur = a;
+  REQUIRE_FALSE(cur);
+  CHECK(cur.error() == err_enum::timeout);
+
+  status old = a.exchange(status(7));
+  CHECK(old.error() == err_enum::timeout);
+  CHECK(*a.load() == 7);
+
+  status expected_value(8);
+  CHECK_FALSE(a.compare_exchange_strong(expected_value, status(9)));
+  CHECK(*expected_value == 7);
+  CHECK(a.compare_exchange_strong(expected_value, status(9)));
+  CHECK(*a.load() == 9);
+
+  // An error with the same bits as a value is still different.
+  status as_error(unexpect, err_enum{9});
+  CHECK_FALSE(a.compare_exchange_strong(as_error, status(1)));
+  CHECK(*as_error == 9);
+
+  status weak(9);
+  while (!a.compare_exchange_weak(weak, status(unexpect, err_enum::refused))) {
+  }
+  CHECK(a.load().error() == err_enum::refused);
+
+  atomic_expected<void, err_enum> v;
+  CHECK(v.load());
+  v = expected<void, err_enum>(unexpect, err_enum::refused);
+  CHECK(v.load().error() == err_enum::refused);
+}
+
+#if defined(__x86_64__)
+TEST_CASE("Double width atomic expected", "[atomic.wide]") {
+  using status = expected<std::uint64_t, err_enum>;
+  atomic_expected<std::uint64_t, err_enum> a;
+  CHECK(*a.load() == 0);
+  a.store(status(UINT64_MAX));
+  CHECK(*a.load() == UINT64_MAX);
+  status e(UINT64_MAX);
+  CHECK(a.compare_exchange_strong(e, status(unexpect, err_enum::timeout)));
+  CHECK(a.exchange(status(3)).error() == err_enum::timeout);
+  CHECK(*a.load() == 3);
+
+  const atomic_expected<std::uint64_t, err_enum> c(status(7));
+  CHECK(*c.load() == 7);
+}
+#endif
+
+TEST_CASE("Atomic expected readers see published values",
+          "[atomic.threads]") {
+  using status = expected<std::uint32_t, err_enum>;
+  constexpr std::uint32_t last = 20000;
+  atomic_expected<std::uint32_t, err_enum> a(status(0));
+
+  std::vector<std::thread> readers;
+  std::vector<int> bad(4, 0);
+  for (int r = 0; r < 4; ++r) {
+    readers.emplace_back([&, r] {
+      std::uint32_t prev = 0;
+      for (;;) {
+        status s = a.load(std::memory_order_acquire);
+        if (!s) {
+          bad[r] += s.error() != err_enum::refused;
+          continue;
+        }
+        bad[r] += *s < prev;
+        prev = *s;
+        if (prev == last) {
+          break;
+        }
+      }
+    });
+  }
+  for (std::uint32_t i = 1; i <= last; ++i) {
+    if (i % 100 == 0) {
+      a.store(status(unexpect, err_enum::refused), std::memory_order_release);
+    }
+    a.store(status(i), std::memory_order_release);
+  }
+  for (auto &t : readers) {
+    t.join();
+  }
+  CHECK(bad == std::vector<int>(4, 0));
+}
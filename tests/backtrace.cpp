@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: CC0-1.0
+#include "catch.hpp"
+#include <experimental/expected_backtrace.hpp>
+#include <string>
+
+using std::experimental::backtrace_frames;
+using std::experimental::expected;
+using std::experimental::one_in_sampler;
+using std::experimental::token_bucket_sampler;
+using std::experimental::traced_error;
+
+namespace {
+expected<int, traced_error<std::string>> fail() {
+  return EXPECTED_TRACED_UNEXPECTED(one_in_sampler(3), "failed");
+}
+} // namespace
+
+TEST_CASE("Sample one error in n", "[backtrace.one_in]") {
+  int sampled = 0;
+  for (int i = 0; i < 9; ++i) {
+    auto r = fail();
+    REQUIRE_FALSE(r);
+    CHECK(r.error().error() == "failed");
+    if (const auto &trace = r.error().backtrace()) {
+      CHECK(i % 3 == 0);
+      CHECK(trace->size() > 0);
+      CHECK(trace->symbolize().size() == trace->size());
+      ++sampled;
+    }
+  }
+  CHECK(sampled == (EXPECTED_HAS_BACKTRACE ? 3 : 0));
+
+  expected<int, traced_error<std::string>> converted =
+      expected<int, traced_error<const char *>>(
+          EXPECTED_TRACED_UNEXPECTED(one_in_sampler(1), "converted"));
+  CHECK(converted.error().error() == "converted");
+  CHECK(bool(converted.error().backtrace()) == EXPECTED_HAS_BACKTRACE);
+}
+
+TEST_CASE("Token bucket sampler", "[backtrace.token_bucket]") {
+  token_bucket_sampler sampler(0.001, 2);
+  CHECK(sampler.sample());
+  CHECK(sampler.sample());
+  CHECK_FALSE(sampler.sample());
+  CHECK_FALSE(sampler.sample());
+
+  token_bucket_sampler fast(1e9, 1);
+  int taken = 0;
+  for (int i = 0; i < 100; ++i) {
+    taken += fast.sample();
+  }
+  CHECK(taken > 1);
+}
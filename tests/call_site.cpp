@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: CC0-1.0
+#define EXPECTED_CALL_SITES 1
+#include "catch.hpp"
+#include <cstring>
+#include <experimental/expected_call_site.hpp>
+#include <string>
+#include <type_traits>
+
+using std::experimental::basic_located_error;
+using std::experimental::call_site_id;
+using std::experimental::expected;
+using std::experimental::located_error;
+
+namespace {
+unsigned negative_line = 0;
+
+expected<int, located_error<std::string>> parse(int x) {
+  if (x < 0) {
+    negative_line = __LINE__ + 1;
+    return EXPECTED_UNEXPECTED("negative");
+  }
+  if (x > 100) {
+    return EXPECTED_UNEXPECTED(std::string("too large"));
+  }
+  return x;
+}
+
+// Each instantiation has its own static id, but they share one site.
+template <class T> call_site_id site_of() {
+  return EXPECTED_UNEXPECTED(T()).value().site();
+}
+} // namespace
+
+TEST_CASE("Errors record interned call sites", "[call_site.intern]") {
+  auto negative = parse(-1);
+  auto large = parse(1000);
+  REQUIRE_FALSE(negative);
+  REQUIRE_FALSE(large);
+  CHECK(negative.error().error() == "negative");
+  CHECK(large.error().error() == "too large");
+
+  const call_site_id id = negative.error().site();
+  CHECK(id != 0);
+  CHECK(large.error().site() != id);
+  CHECK(parse(-2).error().site() == id);
+
+  auto where = negative.error().location();
+  REQUIRE(where);
+  CHECK(std::strstr(where->file, "call_site.cpp"));
+  CHECK(std::string(where->function) == "parse");
+  CHECK(where->line == negative_line);
+
+  CHECK(site_of<int>() == site_of<long>());
+  CHECK(site_of<int>() != id);
+
+  CHECK_FALSE(std::experimental::call_site_registry::lookup(0));
+  CHECK(negative.error() == located_error<std::string>(0, "negative"));
+}
+
+TEST_CASE("Call site modes are distinct types", "[call_site.modes]") {
+  static_assert(
+      std::is_same_v<located_error<int>, basic_located_error<int, true>>);
+  static_assert(sizeof(basic_located_error<int, false>) == sizeof(int));
+
+  const basic_located_error<std::string, false> off(7, "negative");
+  CHECK(off.site() == 0);
+  CHECK_FALSE(off.location());
+}
@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: CC0-1.0
+#include "catch.hpp"
+#include <experimental/expected_cancellation.hpp>
+
+#include <string>
+
+using std::experimental::cancellable_and_then;
+using std::experimental::cancellation_source;
+using std::experimental::cancellation_token;
+using std::experimental::expected;
+using std::experimental::unexpect;
+
+TEST_CASE("Cancellation source and token", "[cancellation.token]") {
+  cancellation_token none;
+  CHECK_FALSE(none.can_be_cancelled());
+  CHECK_FALSE(none.is_cancellation_requested());
+
+  cancellation_source source;
+  auto token = source.token();
+  CHECK(token.can_be_cancelled());
+  CHECK_FALSE(token.is_cancellation_requested());
+  CHECK(source.request_cancellation());
+  CHECK_FALSE(source.request_cancellation());
+  CHECK(token.is_cancellation_requested());
+}
+
+TEST_CASE("Cancellable and_then chain", "[cancellation.and_then]") {
+  using result = expected<int, std::string>;
+  cancellation_source source;
+  int calls = 0;
+  auto add = [&calls](int x) {
+    ++calls;
+    return result(x + 1);
+  };
+  auto cancel = [&](int x) {
+    source.request_cancellation();
+    return result(x * 10);
+  };
+
+  CHECK(cancellable_and_then(result(1), source.token(), "cancelled", add,
+                             add) == result(3));
+  CHECK(calls == 2);
+
+  calls = 0;
+  auto stopped = cancellable_and_then(result(1), source.token(), "cancelled",
+                                      add, cancel, add, add);
+  CHECK(stopped == result(unexpect, "cancelled"));
+  CHECK(calls == 1);
+
+  calls = 0;
+  auto skipped =
+      cancellable_and_then(result(1), source.token(), "cancelled", add);
+  CHECK(skipped == result(unexpect, "cancelled"));
+  CHECK(calls == 0);
+
+  CHECK(cancellable_and_then(result(unexpect, "io"), source.token(),
+                             "cancelled", add) == result(unexpect, "io"));
+  CHECK(cancellable_and_then(result(4), cancellation_token(), "cancelled",
+                             add) == result(5));
+
+  auto to_void = [](int) { return expected<void, std::string>(); };
+  auto from_void = [] { return expected<double, std::string>(0.5); };
+  CHECK(cancellable_and_then(result(1), cancellation_token(), "cancelled",
+                             to_void, from_void) ==
+        expected<double, std::string>(0.5));
+}
@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: CC0-1.0
+#include "catch.hpp"
+#include <experimental/expected_context.hpp>
+#include <string>
+#include <vector>
+
+using std::experimental::add_context;
+using std::experimental::context_error;
+using std::experimental::error_arena;
+using std::experimental::expected;
+using std::experimental::unexpected;
+
+namespace {
+using read_error = context_error<int>;
+
+expected<std::string, read_error> read_file(const std::string &path) {
+  return unexpected(read_error(2, "open " + path));
+}
+} // namespace
+
+TEST_CASE("Context chains", "[context.chain]") {
+  error_arena arena(256);
+  error_arena::scope scope(arena);
+
+  std::string tenant = "for tenant acme";
+  auto r = read_file("users.db")
+               .map_error(add_context("while loading users"))
+               .map_error(add_context(tenant));
+  tenant.clear();
+  REQUIRE_FALSE(r);
+  CHECK(r.error().error() == 2);
+  CHECK(r.error().context_string() ==
+        "for tenant acme: while loading users: open users.db");
+
+  std::vector<std::string_view> frames(r.error().context().begin(),
+                                       r.error().context().end());
+  CHECK(frames.size() == 3);
+  CHECK(frames.back() == "open users.db");
+
+  read_error inner(5);
+  CHECK(inner.context().empty());
+  read_error outer = inner.with_context("outer");
+  CHECK(inner.context().empty());
+  CHECK(outer.context_string() == "outer");
+}
+
+TEST_CASE("Arena reuse", "[context.arena]") {
+  error_arena arena(64);
+  void *first = arena.allocate(8, 8);
+  arena.allocate(200, 16);
+  CHECK(reinterpret_cast<std::uintptr_t>(arena.allocate(4, 16)) % 16 == 0);
+  arena.reset();
+  CHECK(arena.allocate(8, 8) == first);
+
+  const std::string big(100, 'x');
+  read_error e(1, big, arena);
+  CHECK(e.context_string() == big);
+
+  error_arena &local = error_arena::current();
+  {
+    error_arena::scope scope(arena);
+    CHECK(&error_arena::current() == &arena);
+  }
+  CHECK(&error_arena::current() == &local);
+}
@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: CC0-1.0
+#include "catch.hpp"
+#include <experimental/expected_coroutine.hpp>
+
+#if defined(EXPECTED_HAS_COROUTINES)
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+using std::experimental::expected;
+using std::experimental::unexpect;
+using std::experimental::unexpected;
+
+namespace {
+expected<int, std::string> parse(const std::string &s) {
+  if (s.empty() || s.find_first_not_of("0123456789") != std::string::npos) {
+    return expected<int, std::string>(unexpect, "bad number: " + s);
+  }
+  return std::stoi(s);
+}
+
+int steps = 0;
+
+expected<int, std::string> add(const std::string &a, const std::string &b) {
+  int x = co_await parse(a);
+  ++steps;
+  int y = co_await parse(b);
+  ++steps;
+  co_return x + y;
+}
+
+expected<void, std::string> check_positive(int v) {
+  if (v <= 0) {
+    co_await unexpected<std::string>("not positive");
+  }
+}
+
+expected<std::unique_ptr<int>, std::string> boxed(int v) {
+  co_await check_positive(v);
+  co_return std::make_unique<int>(v);
+}
+
+expected<int, std::string> throws() {
+  co_await parse("1");
+  throw std::runtime_error("boom");
+}
+
+template <class T> struct counting_allocator {
+  using value_type = T;
+  int *count;
+  explicit counting_allocator(int *c) : count(c) {}
+  template <class U>
+  counting_allocator(const counting_allocator<U> &rhs) : count(rhs.count) {}
+  T *allocate(std::size_t n) {
+    ++*count;
+    return std::allocator<T>().allocate(n);
+  }
+  void deallocate(T *p, std::size_t n) {
+    --*count;
+    std::allocator<T>().deallocate(p, n);
+  }
+};
+
+// GCC pairs the allocator_arg_t operator new with the usual operator delete
+// the frame is released through and warns without optimization.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+expected<int, std::string> with_allocator(std::allocator_arg_t,
+                                          counting_allocator<char> alloc,
+                                          const std::string &s) {
+  CHECK(*alloc.count == 1);
+  co_return co_await parse(s) * 2;
+}
+
+struct parser {
+  int base;
+  expected<int, std::string> parse_offset(std::allocator_arg_t,
+                                          counting_allocator<char>,
+                                          const std::string &s) {
+    co_return base + co_await parse(s);
+  }
+};
+} // namespace
+
+TEST_CASE("Coroutine early return", "[coroutine.await]") {
+  steps = 0;
+  auto ok = add("20", "22");
+  REQUIRE(ok);
+  CHECK(*ok == 42);
+  CHECK(steps == 2);
+
+  steps = 0;
+  auto bad = add("x", "1");
+  REQUIRE_FALSE(bad);
+  CHECK(bad.error() == "bad number: x");
+  CHECK(steps == 0);
+
+  steps = 0;
+  CHECK(add("1", "y").error() == "bad number: y");
+  CHECK(steps == 1);
+
+  CHECK(**boxed(3) == 3);
+  CHECK(boxed(-1).error() == "not positive");
+  CHECK_THROWS_AS(throws(), std::runtime_error);
+}
+
+TEST_CASE("Coroutine frame allocator", "[coroutine.alloc]") {
+  int live = 0;
+  counting_allocator<char> alloc(&live);
+  CHECK(*with_allocator(std::allocator_arg, alloc, "21") == 42);
+  CHECK(with_allocator(std::allocator_arg, alloc, "?").error() ==
+        "bad number: ?");
+  CHECK(live == 0);
+
+  parser p{100};
+  CHECK(*p.parse_offset(std::allocator_arg, alloc, "5") == 105);
+  CHECK(live == 0);
+}
+#endif
@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: CC0-1.0
+#include "catch.hpp"
+#include <experimental/expected_deferred_error.hpp>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+using std::experimental::deferred_error;
+using std::experimental::error_context;
+using std::experimental::expected;
+using std::experimental::unexpected;
+
+using io_error = deferred_error<std::errc>;
+
+TEST_CASE("Deferred error message", "[deferred_error.message]") {
+  static_assert(std::is_trivially_copyable_v<io_error>);
+
+  io_error plain(std::errc::io_error);
+  CHECK(plain.code() == std::errc::io_error);
+  CHECK(plain.message().empty());
+
+  std::string path = "/etc/app.conf";
+  io_error e(std::errc::no_such_file_or_directory,
+             "open {} failed (attempt {}, {}s, {{{}}}, '{}')", path, 3, 0.5,
+             true, 'x');
+  path = "changed";
+  CHECK(e.message() ==
+        "open /etc/app.conf failed (attempt 3, 0.5s, {true}, 'x')");
+  CHECK(io_error(std::errc::io_error, "{} {} {}", -7, 42u, std::errc::io_error)
+            .message() == "-7 42 5");
+  CHECK(io_error(std::errc::io_error, "missing {}").message() == "missing {}");
+  CHECK(io_error(std::errc::io_error, "{} {}", 1e20, -0.25).message() ==
+        "1e+20 -0.25");
+}
+
+TEST_CASE("Deferred error arguments", "[deferred_error.arguments]") {
+  // The format is kept by pointer, so mutable arrays must not bind.
+  static_assert(
+      std::is_constructible_v<io_error, std::errc, const char (&)[4]>);
+  static_assert(!std::is_constructible_v<io_error, std::errc, char (&)[4]>);
+
+  const std::string name(300, 'x');
+  deferred_error<int, 512> large(1, "name {}", name);
+  CHECK(large.message() == "name " + name);
+  deferred_error<int, 256> small(1, "name {}", name);
+  CHECK(small.message() == "...");
+}
+
+TEST_CASE("Deferred error context", "[deferred_error.context]") {
+  auto open_file = [](const char *name) -> expected<int, io_error> {
+    return unexpected(io_error(std::errc::permission_denied, "open {}", name));
+  };
+
+  auto r = open_file("db.sqlite")
+               .map_error(error_context("loading schema {}", 2))
+               .map_error([](io_error e) {
+                 return std::move(e).with_context("startup");
+               });
+  REQUIRE_FALSE(r);
+  CHECK(r.error().code() == std::errc::permission_denied);
+  CHECK(r.error().message() ==
+        "startup: loading schema 2: open db.sqlite");
+
+  deferred_error<int, 24> small(1, "inner {}", 1);
+  auto outer = small.with_context("a very long context {}", "argument");
+  CHECK(small.message() == "inner 1");
+  CHECK(outer.message() == "...: inner 1");
+
+  // A dropped layer shows where it was, and a run of them shows once.
+  const std::string name(100, 'x');
+  auto middle = deferred_error<int, 64>(1, "inner")
+                    .with_context("name {}", name)
+                    .with_context("name {}", name)
+                    .with_context("outer");
+  CHECK(middle.message() == "outer: ...: inner");
+
+  // More layers than an unsigned char can count.
+  deferred_error<int, 4096> deep(1, "0");
+  for (int i = 0; i < 300; ++i) {
+    deep = deep.with_context("x");
+  }
+  const std::string message = deep.message();
+  CHECK(message.size() == 300 * 3 + 1);
+  CHECK(message.substr(message.size() - 4) == "x: 0");
+}
+
+TEST_CASE("Deferred error context refers to strings",
+          "[deferred_error.context_view]") {
+  const std::string table = "accounts";
+  auto context = error_context("reading {}", table);
+  static_assert(std::is_same_v<
+                decltype(context),
+                std::experimental::detail::deferred_context<std::string_view>>);
+  CHECK(context(io_error(std::errc::io_error)).message() ==
+        "reading accounts");
+}
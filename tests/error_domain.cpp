@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: CC0-1.0
+#include "catch.hpp"
+#include <experimental/expected_error_domain.hpp>
+
+using std::experimental::convert_error;
+using std::experimental::domain_name;
+using std::experimental::error_entry;
+using std::experimental::error_message;
+using std::experimental::error_name;
+using std::experimental::expected;
+using std::experimental::is_error_domain_v;
+using std::experimental::to_domain;
+using std::experimental::unexpected;
+
+namespace {
+enum class io_errc : unsigned char { not_found, denied, busy };
+enum class app_errc : int { internal, missing, forbidden };
+} // namespace
+
+template <> struct std::experimental::error_domain<io_errc> {
+  static constexpr std::string_view name = "io";
+  static constexpr error_entry entries[] = {
+      {"not_found", "no such file"},
+      {"denied", "permission denied"},
+      {"busy", "device busy"}};
+};
+
+template <> struct std::experimental::error_domain<app_errc> {
+  static constexpr std::string_view name = "app";
+  static constexpr error_entry entries[] = {
+      {"internal", "internal error"},
+      {"missing", "resource missing"},
+      {"forbidden", "access forbidden"}};
+};
+
+template <>
+struct std::experimental::error_domain_conversion<io_errc, app_errc> {
+  static constexpr app_errc table[] = {app_errc::missing,
+                                       app_errc::forbidden};
+  static constexpr app_errc fallback = app_errc::internal;
+};
+
+TEST_CASE("Error domain tables", "[error_domain.lookup]") {
+  static_assert(is_error_domain_v<io_errc>);
+  static_assert(!is_error_domain_v<int>);
+  static_assert(sizeof(expected<int, io_errc>) <= 2 * sizeof(int));
+  static_assert(domain_name<io_errc>() == "io");
+  static_assert(error_name(io_errc::denied) == "denied");
+  static_assert(error_message(io_errc::busy) == "device busy");
+
+  CHECK(error_name(static_cast<io_errc>(9)) == "unknown");
+  CHECK(error_message(unexpected(app_errc::missing)) == "resource missing");
+}
+
+TEST_CASE("Error domain conversion", "[error_domain.convert]") {
+  static_assert(convert_error<app_errc>(io_errc::denied) ==
+                app_errc::forbidden);
+  static_assert(convert_error<app_errc>(io_errc::busy) == app_errc::internal);
+  CHECK(convert_error<app_errc>(unexpected(io_errc::not_found)) ==
+        unexpected(app_errc::missing));
+
+  expected<int, io_errc> r = unexpected(io_errc::denied);
+  expected<int, app_errc> mapped = r.map_error(to_domain<app_errc>);
+  CHECK(mapped == unexpected(app_errc::forbidden));
+}
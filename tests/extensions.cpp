@@ -1,8 +1,11 @@
 // SPDX-License-Identifier: CC0-1.0
 #include "catch.hpp"
 #include <experimental/expected.hpp>
+#include <stdexcept>
+#include <string>
 
 using std::experimental::expected;
+using std::experimental::try_invoke;
 using std::experimental::unexpect;
 
 TEST_CASE("Map extensions", "[extensions.map]") {
@@ -545,6 +548,81 @@ TEST_CASE("or_else", "[extensions.or_else]") {
     CHECK(ret.error() == 21);
   }
 }
+namespace {
+int parse(const std::string &s) {
+  if (s.empty()) {
+    throw std::invalid_argument("empty");
+  }
+  return std::stoi(s);
+}
+
+struct message_translator {
+  std::string operator()() const {
+    try {
+      throw;
+    } catch (const std::exception &e) {
+      return e.what();
+    }
+  }
+};
+} // namespace
+
+TEST_CASE("try_invoke", "[extensions.try_invoke]") {
+  auto ok = try_invoke<std::exception_ptr>(parse, "12");
+  STATIC_REQUIRE(
+      std::is_same<decltype(ok), expected<int, std::exception_ptr>>::value);
+  CHECK(*ok == 12);
+
+  auto bad = try_invoke<std::exception_ptr>(parse, "");
+  REQUIRE_FALSE(bad);
+  CHECK_THROWS_AS(std::rethrow_exception(bad.error()), std::invalid_argument);
+
+  auto caught = try_invoke<std::invalid_argument>(parse, "");
+  REQUIRE_FALSE(caught);
+  CHECK(std::string(caught.error().what()) == "empty");
+  CHECK_THROWS_AS(try_invoke<std::out_of_range>(parse, ""),
+                  std::invalid_argument);
+
+  auto translated = try_invoke<std::string, message_translator>(parse, "");
+  CHECK(translated.error() == "empty");
+
+  int calls = 0;
+  auto quiet = [&calls]() noexcept { ++calls; };
+  STATIC_REQUIRE(std::is_same<decltype(try_invoke<int>(quiet)),
+                              expected<void, int>>::value);
+  CHECK(try_invoke<int>(quiet));
+  CHECK(calls == 1);
+}
+
+TEST_CASE("map_catching", "[extensions.map_catching]") {
+  expected<std::string, std::exception_ptr> e("7");
+  auto ok = e.map_catching(parse);
+  CHECK(*ok == 7);
+
+  e = "";
+  auto bad = std::move(e).map_catching(parse);
+  REQUIRE_FALSE(bad);
+  CHECK_THROWS_AS(std::rethrow_exception(bad.error()), std::invalid_argument);
+
+  const expected<std::string, std::string> failed(unexpect, "earlier");
+  auto kept = failed.map_catching<message_translator>(parse);
+  CHECK(kept.error() == "earlier");
+
+  expected<std::string, std::string> empty("");
+  CHECK(empty.map_catching<message_translator>(parse).error() == "empty");
+  auto lambda = empty.map_catching<message_translator>(
+      [](const std::string &s) { return parse(s); });
+  CHECK(lambda.error() == "empty");
+
+  expected<void, std::exception_ptr> v;
+  auto thrown = v.map_catching([]() -> int { throw std::runtime_error("x"); });
+  CHECK_FALSE(thrown);
+  auto unit = v.map_catching([] {});
+  STATIC_REQUIRE(
+      std::is_same<decltype(unit), expected<void, std::exception_ptr>>::value);
+  CHECK(unit);
+}
+
 struct S {
   int x;
 };
@@ -0,0 +1,133 @@
+// SPDX-License-Identifier: CC0-1.0
+#include "catch.hpp"
+#include <experimental/expected_future.hpp>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::experimental::expected;
+using std::experimental::expected_future;
+using std::experimental::expected_promise;
+using std::experimental::expected_shared_state;
+
+TEST_CASE("Promise and future on one thread", "[future.basic]") {
+  expected_promise<int, std::string> p;
+  auto f = p.get_future();
+  CHECK(f.valid());
+  CHECK_FALSE(f.is_ready());
+  p.set_value(42);
+  CHECK_FALSE(p.valid());
+  CHECK(f.is_ready());
+  auto ret = f.get();
+  CHECK_FALSE(f.valid());
+  CHECK(*ret == 42);
+
+  expected_promise<std::unique_ptr<int>, std::string> q;
+  auto g = q.get_future();
+  q.set_error("broken");
+  CHECK(g.get().error() == "broken");
+
+  expected_future<void, int> v;
+  {
+    expected_promise<void, int> r;
+    v = r.get_future();
+  }
+  CHECK(v.is_ready());
+  CHECK(v.is_broken());
+  auto abandoned = v.get_or(-1);
+  REQUIRE_FALSE(abandoned);
+  CHECK(abandoned.error() == -1);
+}
+
+namespace {
+struct no_default {
+  explicit no_default(int v) : value(v) {}
+  int value;
+};
+struct throws_on_construct {
+  explicit throws_on_construct(bool fail) {
+    if (fail) {
+      throw 1;
+    }
+  }
+};
+} // namespace
+
+TEST_CASE("Broken promises", "[future.broken]") {
+  expected_future<int, no_default> f;
+  {
+    expected_promise<int, no_default> p;
+    f = p.get_future();
+  }
+  REQUIRE(f.is_broken());
+  CHECK(f.get_or(7).error().value == 7);
+
+  expected_promise<throws_on_construct, int> p;
+  auto g = p.get_future();
+  CHECK_THROWS(p.set_value(true));
+  CHECK(p.valid());
+  CHECK_FALSE(g.is_ready());
+  p.set_value(false);
+  CHECK_FALSE(g.is_broken());
+  CHECK(g.get_or(0).has_value());
+
+  expected_shared_state<throws_on_construct, int> state;
+  expected_future<throws_on_construct, int> h;
+  {
+    expected_promise<throws_on_construct, int> q(state);
+    h = q.get_future();
+    CHECK_THROWS(q.set_value(true));
+  }
+  CHECK(h.is_broken());
+  CHECK(h.get_or(3).error() == 3);
+  // Both ends released the caller's state, so it can be reused.
+  expected_promise<throws_on_construct, int> q(state);
+  auto k = q.get_future();
+  q.set_value(false);
+  CHECK(k.get().has_value());
+}
+
+TEST_CASE("Caller supplied shared state", "[future.storage]") {
+  expected_shared_state<std::string, int> state;
+  for (int i = 0; i < 3; ++i) {
+    expected_promise<std::string, int> p(state);
+    auto f = p.get_future();
+    p.set_result(expected<std::string, int>(std::to_string(i)));
+    CHECK(*f.get() == std::to_string(i));
+  }
+}
+
+TEST_CASE("Results cross threads", "[future.threads]") {
+  constexpr int workers = 8;
+  std::vector<expected_shared_state<int, std::string>> states(workers);
+  std::vector<expected_future<int, std::string>> futures;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < workers; ++i) {
+    expected_promise<int, std::string> p(states[i]);
+    futures.push_back(p.get_future());
+    threads.emplace_back([i, p = std::move(p)]() mutable {
+      std::this_thread::yield();
+      if (i % 3 == 0) {
+        p.set_error("worker " + std::to_string(i));
+      } else {
+        p.set_value(i * i);
+      }
+    });
+  }
+  int sum = 0;
+  int errors = 0;
+  for (auto &f : futures) {
+    auto r = f.get();
+    if (r) {
+      sum += *r;
+    } else {
+      ++errors;
+    }
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  CHECK(errors == 3);
+  CHECK(sum == 1 + 4 + 16 + 25 + 49);
+}
@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: CC0-1.0
+#include "catch.hpp"
+#include <experimental/expected_intern.hpp>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+using std::experimental::expected;
+using std::experimental::interned_error;
+using std::experimental::make_interned_unexpected;
+using std::experimental::unexpected;
+
+namespace {
+struct outage {
+  int code;
+  std::string message;
+  bool operator==(const outage &o) const {
+    return code == o.code && message == o.message;
+  }
+};
+
+struct outage_hash {
+  std::size_t operator()(const outage &o) const {
+    return std::hash<std::string>()(o.message) ^ std::size_t(o.code);
+  }
+};
+
+using outage_error = interned_error<outage, outage_hash>;
+} // namespace
+
+TEST_CASE("Interned errors share records", "[intern.share]") {
+  STATIC_REQUIRE(std::is_trivially_copyable<outage_error>::value);
+  STATIC_REQUIRE(sizeof(outage_error) == sizeof(void *));
+
+  std::vector<const outage *> seen(8);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&seen, t] {
+      for (int i = 0; i < 1000; ++i) {
+        outage_error e(outage{503, "upstream unavailable"});
+        seen[t] = &e.error();
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  for (const outage *p : seen) {
+    CHECK(p == seen[0]);
+  }
+
+  outage_error a(outage{503, "upstream unavailable"});
+  outage_error b(outage{504, "upstream timeout"});
+  CHECK(&a.error() == seen[0]);
+  CHECK(a != b);
+  CHECK(b->code == 504);
+  CHECK(outage_error::table_type::instance().size() == 2);
+}
+
+TEST_CASE("Interned lookups past the thread cache", "[intern.cache]") {
+  // More values than the per-thread cache holds, so entries get evicted
+  // and the second pass has to fall back to the table for some of them.
+  std::vector<const int *> first;
+  for (int i = 0; i < 1000; ++i) {
+    first.push_back(&interned_error<int>(i).error());
+  }
+  for (int i = 999; i >= 0; --i) {
+    interned_error<int> e(i);
+    CHECK(&e.error() == first[i]);
+    CHECK(*e == i);
+  }
+  CHECK(interned_error<int>::table_type::instance().size() == 1000);
+}
+
+TEST_CASE("Interned errors in expected", "[intern.expected]") {
+  auto fetch = [](int id) -> expected<int, interned_error<std::string>> {
+    if (id < 0) {
+      return make_interned_unexpected(std::string("bad id"));
+    }
+    return id;
+  };
+  auto r = fetch(-1).and_then(fetch).and_then(fetch);
+  REQUIRE_FALSE(r);
+  CHECK(*r.error() == "bad id");
+  CHECK(r.error() == fetch(-2).error());
+
+  expected<int, interned_error<std::string>> s =
+      unexpected(std::string("bad id"));
+  CHECK(&s.error().error() == &r.error().error());
+}
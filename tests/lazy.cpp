@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: CC0-1.0
+#include "catch.hpp"
+#include <atomic>
+#include <experimental/expected_lazy.hpp>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::experimental::expected;
+using std::experimental::lazy_error_policy;
+using std::experimental::lazy_expected;
+using std::experimental::unexpect;
+
+TEST_CASE("Lazy expected computes once", "[lazy.once]") {
+  std::atomic<int> calls{0};
+  lazy_expected schema([&calls] {
+    ++calls;
+    return expected<std::string, int>("schema");
+  });
+  CHECK_FALSE(schema.is_ready());
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 8; ++i) {
+    readers.emplace_back([&schema] { CHECK(*schema.get() == "schema"); });
+  }
+  for (auto &t : readers) {
+    t.join();
+  }
+  CHECK(calls == 1);
+  CHECK(schema.is_ready());
+  CHECK(&schema.get() == &schema.get());
+}
+
+TEST_CASE("Lazy expected error policies", "[lazy.errors]") {
+  int calls = 0;
+  auto flaky = [&calls] {
+    return ++calls < 3 ? expected<int, int>(unexpect, calls)
+                       : expected<int, int>(42);
+  };
+
+  lazy_expected cached(flaky);
+  CHECK(cached.get() == expected<int, int>(unexpect, 1));
+  CHECK(cached.get() == expected<int, int>(unexpect, 1));
+  CHECK(calls == 1);
+
+  calls = 0;
+  lazy_expected<int, int, lazy_error_policy::retry, decltype(flaky)> retried(
+      flaky);
+  CHECK(retried.get().error() == 1);
+  CHECK_FALSE(retried.is_ready());
+  CHECK(retried.get().error() == 2);
+  const int &value = *retried.get();
+  CHECK(value == 42);
+  CHECK(&retried.get()->get() == &value);
+  CHECK(calls == 3);
+
+  lazy_expected<void, int, lazy_error_policy::retry> device(
+      [] { return expected<void, int>(); });
+  CHECK(device.get());
+}
+
+TEST_CASE("Lazy expected retries after a throw", "[lazy.throw]") {
+  int calls = 0;
+  lazy_expected<int, int> lazy([&calls]() -> expected<int, int> {
+    if (++calls == 1) {
+      throw std::runtime_error("busy");
+    }
+    return 7;
+  });
+  CHECK_THROWS_AS(lazy.get(), std::runtime_error);
+  CHECK(*lazy.get() == 7);
+  CHECK(calls == 2);
+}
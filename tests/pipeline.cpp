@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: CC0-1.0
+#include "catch.hpp"
+#include <experimental/expected_pipeline.hpp>
+#include <string>
+
+using std::experimental::expected;
+using std::experimental::pipeline;
+using std::experimental::unexpect;
+
+namespace {
+struct counted_error {
+  static inline int copies = 0;
+  static inline int moves = 0;
+  int code;
+  explicit counted_error(int c) : code(c) {}
+  counted_error(const counted_error &rhs) : code(rhs.code) { ++copies; }
+  counted_error(counted_error &&rhs) noexcept : code(rhs.code) { ++moves; }
+  counted_error &operator=(const counted_error &) = default;
+  counted_error &operator=(counted_error &&) = default;
+};
+} // namespace
+
+TEST_CASE("Pipeline evaluation", "[pipeline.eval]") {
+  auto mul2 = [](int a) { return a * 2; };
+  auto half = [](int a) -> expected<int, int> {
+    if (a % 2) {
+      return expected<int, int>(unexpect, a);
+    }
+    return a / 2;
+  };
+
+  {
+    expected<int, int> e = 21;
+    expected<int, int> ret = pipeline(e).map(mul2).and_then(half).map(mul2);
+    CHECK(ret);
+    CHECK(*ret == 42);
+    CHECK(*e == 21);
+  }
+
+  {
+    auto ret = pipeline(expected<int, int>(21)).and_then(half).map(mul2).eval();
+    CHECK_FALSE(ret);
+    CHECK(ret.error() == 21);
+  }
+
+  {
+    auto ret = pipeline(expected<int, int>(unexpect, 1))
+                   .map(mul2)
+                   .map_error([](int e) { return std::to_string(e); })
+                   .eval();
+    CHECK(std::is_same_v<decltype(ret), expected<int, std::string>>);
+    CHECK(ret.error() == "1");
+  }
+
+  {
+    auto ret = pipeline(expected<int, int>(3))
+                   .and_then(half)
+                   .or_else([](int e) { return expected<int, int>(e * 4); })
+                   .map(mul2)
+                   .eval();
+    CHECK(*ret == 24);
+  }
+
+  {
+    int seen = 0;
+    auto ret = pipeline(expected<int, int>(unexpect, 7))
+                   .or_else([&](const int &e) { seen = e; })
+                   .eval();
+    CHECK(seen == 7);
+    CHECK(ret.error() == 7);
+  }
+
+  {
+    int seen = 0;
+    auto ret = pipeline(expected<void, int>())
+                   .map([] { return 5; })
+                   .map([&](int v) { seen = v; })
+                   .eval();
+    CHECK(std::is_same_v<decltype(ret), expected<void, int>>);
+    CHECK(ret);
+    CHECK(seen == 5);
+  }
+}
+
+TEST_CASE("Pipeline moves the error once", "[pipeline.error]") {
+  auto inc = [](int a) { return a + 1; };
+  counted_error::copies = 0;
+  counted_error::moves = 0;
+  auto ret = pipeline(expected<int, counted_error>(unexpect, 5))
+                 .map(inc)
+                 .map(inc)
+                 .map(inc)
+                 .map(inc)
+                 .and_then(
+                     [](int a) { return expected<int, counted_error>(a); })
+                 .map(inc)
+                 .map(inc)
+                 .map(inc)
+                 .eval();
+  CHECK_FALSE(ret);
+  CHECK(ret.error().code == 5);
+  CHECK(counted_error::copies == 0);
+  CHECK(counted_error::moves == 1);
+}
+
+TEST_CASE("Pipe adaptors", "[pipeline.pipe]") {
+  namespace ex = std::experimental;
+  auto mul2 = [](int a) { return a * 2; };
+  auto half = [](int a) -> expected<int, int> {
+    if (a % 2) {
+      return expected<int, int>(unexpect, a);
+    }
+    return a / 2;
+  };
+
+  {
+    expected<int, int> e = 21;
+    auto ret = e | ex::map(mul2);
+    CHECK(std::is_same_v<decltype(ret), expected<int, int>>);
+    CHECK(*ret == 42);
+    CHECK((e | ex::map(mul2) | ex::and_then(half) | ex::value_or(0)) == 21);
+    CHECK((expected<int, int>(unexpect, 1) | ex::value_or(3)) == 3);
+  }
+
+  {
+    constexpr auto stored = ex::map([](int a) { return a + 1; }) |
+                            ex::and_then([](int a) -> expected<int, int> {
+                              if (a > 10) {
+                                return expected<int, int>(unexpect, a);
+                              }
+                              return a * 2;
+                            }) |
+                            ex::value_or(-1);
+    int sum = 0;
+    for (int i = 0; i < 20; ++i) {
+      sum += expected<int, int>(i) | stored;
+    }
+    CHECK(sum == 2 * (1 + 2 + 3 + 4 + 5 + 6 + 7 + 8 + 9 + 10) - 10);
+    CHECK((expected<int, int>(unexpect, 5) | stored) == -1);
+  }
+
+  {
+    auto stringify =
+        ex::map_error([](int e) { return std::to_string(e); }) |
+        ex::or_else([](const std::string &) {});
+    auto ret = expected<int, int>(unexpect, 9) | ex::map(mul2) | stringify;
+    CHECK(std::is_same_v<decltype(ret), expected<int, std::string>>);
+    CHECK(ret.error() == "9");
+  }
+}
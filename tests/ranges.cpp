@@ -0,0 +1,138 @@
+// SPDX-License-Identifier: CC0-1.0
+#include "catch.hpp"
+#include <experimental/expected_ranges.hpp>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+using std::experimental::expected;
+using std::experimental::only_errors;
+using std::experimental::only_values;
+using std::experimental::transform_expected;
+using std::experimental::unexpect;
+using std::experimental::values_until_error;
+
+namespace {
+std::vector<expected<int, int>> make_sample() {
+  return {1, 2, expected<int, int>(unexpect, 3), 4,
+          expected<int, int>(unexpect, 5)};
+}
+} // namespace
+
+TEST_CASE("Filtering views", "[ranges.filter]") {
+  auto v = make_sample();
+
+  std::vector<int> values;
+  for (int &x : only_values(v)) {
+    values.push_back(x);
+  }
+  CHECK(values == std::vector<int>{1, 2, 4});
+
+  std::vector<int> errors;
+  for (int e : only_errors(v.begin(), v.end())) {
+    errors.push_back(e);
+  }
+  CHECK(errors == std::vector<int>{3, 5});
+
+  values.clear();
+  auto until = values_until_error(v);
+  auto it = until.begin();
+  for (; it != until.end(); ++it) {
+    values.push_back(*it);
+  }
+  CHECK(values == std::vector<int>{1, 2});
+  CHECK(it.base() == v.begin() + 2);
+  CHECK(it.base()->error() == 3);
+
+  values.clear();
+  for (int x : only_values(make_sample())) {
+    values.push_back(x);
+  }
+  CHECK(values == std::vector<int>{1, 2, 4});
+}
+
+TEST_CASE("Transforming views", "[ranges.transform]") {
+  auto half = [](int x) -> expected<int, int> {
+    if (x % 2) {
+      return expected<int, int>(unexpect, -x);
+    }
+    return x / 2;
+  };
+  int calls = 0;
+  auto parse = [&](const std::string &s) -> expected<int, std::string> {
+    ++calls;
+    if (s.empty() || s.find_first_not_of("0123456789") != std::string::npos) {
+      return expected<int, std::string>(unexpect, s);
+    }
+    return std::stoi(s);
+  };
+
+  {
+    std::istringstream in("1 2 x 4 5");
+    int sum = 0;
+    auto parsed =
+        transform_expected(std::istream_iterator<std::string>(in),
+                           std::istream_iterator<std::string>(), parse);
+    for (int x : values_until_error(parsed)) {
+      sum += x;
+    }
+    CHECK(sum == 3);
+    CHECK(calls == 3);
+  }
+
+  {
+    auto v = make_sample();
+    std::vector<int> values;
+    auto mul10 = [](int x) { return x * 10; };
+    for (int x : only_values(transform_expected(v, mul10))) {
+      values.push_back(x);
+    }
+    CHECK(values == std::vector<int>{10, 20, 40});
+  }
+
+  {
+    auto v = make_sample();
+    std::vector<int> errors;
+    for (int e : only_errors(transform_expected(v, half))) {
+      errors.push_back(e);
+    }
+    CHECK(errors == std::vector<int>{-1, 3, 5});
+  }
+
+#if defined(__cpp_lib_ranges)
+  {
+    auto v = make_sample();
+    STATIC_REQUIRE(std::ranges::view<decltype(only_values(v))>);
+    STATIC_REQUIRE(std::ranges::input_range<decltype(only_values(v))>);
+    STATIC_REQUIRE(
+        std::ranges::input_range<decltype(transform_expected(v, half))>);
+  }
+#endif
+}
+
+TEST_CASE("View iterator categories", "[ranges.category]") {
+  auto v = make_sample();
+  auto half = [](int x) -> expected<int, int> { return x / 2; };
+
+  using values_iterator = decltype(only_values(v).begin());
+  STATIC_REQUIRE(std::is_same_v<
+                 std::iterator_traits<values_iterator>::iterator_category,
+                 std::forward_iterator_tag>);
+
+  // Prvalue elements are cached in the iterator or returned by value, so
+  // these can only be walked once.
+  auto halves = transform_expected(v, half);
+  using transform_iterator = decltype(halves.begin());
+  STATIC_REQUIRE(std::is_same_v<
+                 std::iterator_traits<transform_iterator>::value_type,
+                 expected<int, int>>);
+  STATIC_REQUIRE(std::is_same_v<
+                 std::iterator_traits<transform_iterator>::iterator_category,
+                 std::input_iterator_tag>);
+  using cached_iterator = decltype(only_values(halves).begin());
+  STATIC_REQUIRE(std::is_same_v<
+                 std::iterator_traits<cached_iterator>::iterator_category,
+                 std::input_iterator_tag>);
+}
@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: CC0-1.0
+#include "catch.hpp"
+#include <chrono>
+#include <experimental/expected_report.hpp>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::experimental::error_report;
+using std::experimental::error_reporter;
+using std::experimental::expected;
+using std::experimental::report_errors;
+using std::experimental::unexpect;
+
+namespace {
+struct collected {
+  std::mutex mutex;
+  std::vector<error_report<std::string>> reports;
+
+  auto sink() {
+    return [this](const error_report<std::string> &r) {
+      std::lock_guard<std::mutex> lock(mutex);
+      reports.push_back(r);
+    };
+  }
+  std::map<std::string, std::uint64_t> totals() {
+    std::map<std::string, std::uint64_t> t;
+    for (auto &r : reports) {
+      t[r.error] += r.count;
+    }
+    return t;
+  }
+};
+} // namespace
+
+TEST_CASE("Reports are limited per error value", "[report.limit]") {
+  collected c;
+  {
+    error_reporter<std::string> reporter(c.sink(), 2, std::chrono::hours(1));
+    using result = expected<int, std::string>;
+    for (int i = 0; i < 100; ++i) {
+      auto r = result(unexpect, "db down").or_else(report_errors(reporter));
+      CHECK(r.error() == "db down");
+    }
+    for (int i = 0; i < 3; ++i) {
+      result(unexpect, "cache miss").or_else(report_errors(reporter));
+    }
+    CHECK(result(1).or_else(report_errors(reporter)) == result(1));
+  }
+  // Two reports each, then one summary per value when the reporter stops.
+  CHECK(c.reports.size() == 6);
+  auto totals = c.totals();
+  CHECK(totals["db down"] == 100);
+  CHECK(totals["cache miss"] == 3);
+}
+
+TEST_CASE("Reports from many threads", "[report.threads]") {
+  // The queue is small enough to fill if the background thread falls
+  // behind; every occurrence is then either reported or counted as dropped.
+  constexpr std::uint64_t per_thread = 20000;
+  collected c;
+  std::uint64_t dropped = 0;
+  {
+    error_reporter<std::string> reporter(c.sink(), 1,
+                                         std::chrono::milliseconds(5), 64,
+                                         std::chrono::milliseconds(1));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&reporter, t] {
+        for (std::uint64_t i = 0; i < per_thread; ++i) {
+          reporter.report(i % 2 ? "timeout" : "refused " + std::to_string(t));
+        }
+      });
+    }
+    for (auto &t : threads) {
+      t.join();
+    }
+    // Nothing is dropped once reporting has stopped.
+    dropped = reporter.dropped();
+  }
+  std::uint64_t reported = 0;
+  for (auto &[error, count] : c.totals()) {
+    CHECK(count <= (error == "timeout" ? 4 : 1) * per_thread / 2);
+    reported += count;
+  }
+  CHECK(reported + dropped == 4 * per_thread);
+  CHECK(c.reports.size() < 4 * per_thread);
+}
@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: CC0-1.0
+#include "catch.hpp"
+#include <experimental/expected_ring.hpp>
+#include <memory>
+#include <string>
+#include <thread>
+
+using std::experimental::expected;
+using std::experimental::spsc_expected_ring;
+using std::experimental::unexpect;
+
+TEST_CASE("Ring push and pop", "[ring.basic]") {
+  spsc_expected_ring<std::unique_ptr<int>, std::string> ring(3);
+  CHECK(ring.capacity() == 4);
+  CHECK_FALSE(ring.try_pop());
+
+  CHECK(ring.try_emplace(std::make_unique<int>(1)));
+  CHECK(ring.try_emplace(unexpect, "bad record"));
+  CHECK(ring.try_emplace(std::in_place, new int(3)));
+  CHECK(ring.try_emplace(nullptr));
+  CHECK_FALSE(ring.try_emplace(nullptr));
+  CHECK(ring.size() == 4);
+
+  auto first = ring.try_pop();
+  REQUIRE(first);
+  CHECK(***first == 1);
+  CHECK(ring.try_consume([](expected<std::unique_ptr<int>, std::string> &&r) {
+    CHECK(r.error() == "bad record");
+  }));
+  CHECK(ring.size() == 2);
+  // The rest is released by the destructor.
+}
+
+TEST_CASE("Ring batches", "[ring.batch]") {
+  spsc_expected_ring<int, int> ring(4);
+  CHECK(ring.front().empty());
+  for (int i = 0; i < 3; ++i) {
+    ring.try_emplace(i);
+  }
+  ring.pop(2);
+  for (int i = 3; i < 6; ++i) {
+    CHECK(ring.try_emplace(i));
+  }
+
+  auto batch = ring.front();
+  REQUIRE(batch.size() == 2);
+  CHECK(*batch[0] == 2);
+  CHECK(*batch[1] == 3);
+  ring.pop(batch.size());
+
+  batch = ring.front();
+  REQUIRE(batch.size() == 2);
+  CHECK(*batch.begin()[0] == 4);
+  CHECK(*batch.begin()[1] == 5);
+  ring.pop(batch.size());
+  CHECK(ring.size() == 0);
+}
+
+TEST_CASE("Ring between two threads", "[ring.threads]") {
+  constexpr int count = 100000;
+  spsc_expected_ring<int, int> ring(64);
+  std::thread producer([&ring] {
+    for (int i = 0; i < count; ++i) {
+      while (!(i % 7 == 0 ? ring.try_emplace(unexpect, i)
+                          : ring.try_emplace(i))) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  long long sum = 0;
+  int errors = 0;
+  int seen = 0;
+  while (seen < count) {
+    auto batch = ring.front();
+    for (auto &r : batch) {
+      CHECK(r.has_value() == (seen % 7 != 0));
+      if (r) {
+        sum += *r;
+      } else {
+        ++errors;
+      }
+      ++seen;
+    }
+    ring.pop(batch.size());
+  }
+  producer.join();
+
+  long long expected_sum = 0;
+  for (int i = 0; i < count; ++i) {
+    expected_sum += i % 7 == 0 ? 0 : i;
+  }
+  CHECK(sum == expected_sum);
+  CHECK(errors == (count + 6) / 7);
+}
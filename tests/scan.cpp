@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: CC0-1.0
+#include "catch.hpp"
+#include <array>
+#include <cstdint>
+#include <experimental/expected_scan.hpp>
+#include <random>
+#include <vector>
+
+using std::experimental::all_ok;
+using std::experimental::count_errors;
+using std::experimental::expected;
+using std::experimental::first_error_index;
+using std::experimental::gather_values;
+using std::experimental::unexpect;
+namespace detail = std::experimental::detail;
+
+namespace {
+enum class err_enum : std::uint8_t { timeout = 1, refused };
+
+struct wide {
+  std::int32_t v[9];
+};
+bool operator==(const wide &a, const wide &b) { return a.v[0] == b.v[0]; }
+
+template <class T> T make(int i) {
+  if constexpr (std::is_same_v<T, wide>) {
+    return wide{{i}};
+  } else {
+    return static_cast<T>(i);
+  }
+}
+
+template <class T, class E> void check_kernels(double error_rate) {
+  std::mt19937 rng(42);
+  std::bernoulli_distribution fail(error_rate);
+  std::vector<detail::scan_isa> isas{detail::scan_isa::scalar};
+#if defined(EXPECTED_SCAN_X86)
+  isas.push_back(detail::scan_isa::sse2);
+  if (detail::scan_best_isa() == detail::scan_isa::avx2) {
+    isas.push_back(detail::scan_isa::avx2);
+  }
+#endif
+
+  for (std::size_t n : {0, 1, 7, 31, 64, 257}) {
+    std::vector<expected<T, E>> v;
+    for (std::size_t i = 0; i < n; ++i) {
+      if (fail(rng)) {
+        v.emplace_back(unexpect, E(1));
+      } else {
+        v.emplace_back(make<T>(static_cast<int>(i)));
+      }
+    }
+    std::size_t errors = 0;
+    std::size_t first = n;
+    std::vector<T> values;
+    for (std::size_t i = 0; i < n; ++i) {
+      if (!v[i]) {
+        ++errors;
+        first = std::min(first, i);
+      } else {
+        values.push_back(*v[i]);
+      }
+    }
+    for (auto isa : isas) {
+      CHECK(detail::count_errors(v.data(), n, isa) == errors);
+      CHECK(detail::first_error_index(v.data(), n, isa) == first);
+      std::vector<T> out(n);
+      out.resize(detail::gather_values(v.data(), n, out.data(), isa));
+      CHECK(out == values);
+    }
+    CHECK(count_errors(v) == errors);
+    CHECK(first_error_index(v) == first);
+    CHECK(all_ok(v) == (errors == 0));
+  }
+}
+} // namespace
+
+TEST_CASE("Scan kernels", "[scan]") {
+  for (double rate : {0.0, 0.01, 0.5, 1.0}) {
+    check_kernels<std::int32_t, err_enum>(rate);
+    check_kernels<std::uint8_t, std::uint8_t>(rate);
+    check_kernels<double, int>(rate);
+    check_kernels<wide, int>(rate);
+  }
+}
+
+TEST_CASE("Scan gathers values", "[scan.gather]") {
+  std::array<expected<std::int32_t, err_enum>, 5> a{
+      1, expected<std::int32_t, err_enum>(unexpect, err_enum::timeout), 2, 3,
+      expected<std::int32_t, err_enum>(unexpect, err_enum::refused)};
+  std::int32_t out[5];
+  CHECK(gather_values(a, out) == 3);
+  CHECK(out[0] == 1);
+  CHECK(out[1] == 2);
+  CHECK(out[2] == 3);
+  CHECK(first_error_index(a.data(), a.size()) == 1);
+  CHECK_FALSE(all_ok(a));
+}
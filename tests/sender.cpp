@@ -0,0 +1,223 @@
+// SPDX-License-Identifier: CC0-1.0
+#include "catch.hpp"
+#include <exception>
+#include <experimental/expected_sender.hpp>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using std::experimental::expected;
+using std::experimental::from_expected;
+using std::experimental::into_expected;
+using std::experimental::unexpect;
+
+namespace {
+// Records how it was completed.
+template <class T> struct sink {
+  std::optional<T> *value;
+  std::optional<int> *error;
+  bool *stopped;
+
+  void set_value(T v) && noexcept { value->emplace(std::move(v)); }
+  void set_error(int e) && noexcept { error->emplace(e); }
+  void set_stopped() && noexcept { *stopped = true; }
+};
+
+struct void_sink {
+  bool *done;
+  std::optional<int> *error;
+
+  void set_value() && noexcept { *done = true; }
+  void set_error(int e) && noexcept { error->emplace(e); }
+  void set_stopped() && noexcept {}
+};
+
+// Completes through whichever channel it was built for.
+struct test_sender {
+  enum { value, error, stopped } how;
+
+  template <class R> struct operation {
+    decltype(how) m_how;
+    R m_receiver;
+    void start() & noexcept {
+      if (m_how == value) {
+        std::move(m_receiver).set_value("ok");
+      } else if (m_how == error) {
+        std::move(m_receiver).set_error(7);
+      } else {
+        std::move(m_receiver).set_stopped();
+      }
+    }
+  };
+
+  template <class R> operation<R> connect(R r) const {
+    return {how, std::move(r)};
+  }
+};
+} // namespace
+
+TEST_CASE("Complete a receiver from expected", "[sender.from_expected]") {
+  std::optional<std::string> value;
+  std::optional<int> error;
+  bool stopped = false;
+  using sink_type = sink<std::string>;
+
+  auto ok = from_expected(expected<std::string, int>("hi"));
+  auto op = std::move(ok).connect(sink_type{&value, &error, &stopped});
+  op.start();
+  CHECK(value == "hi");
+  CHECK_FALSE(error);
+
+  value.reset();
+  const auto bad = from_expected(expected<std::string, int>(unexpect, 3));
+  auto op2 = bad.connect(sink_type{&value, &error, &stopped});
+  op2.start();
+  CHECK_FALSE(value);
+  CHECK(error == 3);
+
+  bool done = false;
+  error.reset();
+  auto op3 = from_expected(expected<void, int>())
+                 .connect(void_sink{&done, &error});
+  op3.start();
+  CHECK(done);
+  CHECK_FALSE(error);
+}
+
+namespace {
+// Connects a sink to into_expected(sender) and starts it, with fresh
+// completion slots for every run.
+struct fold_result {
+  std::optional<expected<std::string, int>> value;
+  std::optional<int> error;
+  bool stopped = false;
+};
+
+fold_result fold(test_sender sender) {
+  fold_result ret;
+  auto op = into_expected<std::string, int>(sender).connect(
+      sink<expected<std::string, int>>{&ret.value, &ret.error, &ret.stopped});
+  op.start();
+  return ret;
+}
+} // namespace
+
+TEST_CASE("Fold sender completions into expected",
+          "[sender.into_expected]") {
+  const auto ok = fold(test_sender{test_sender::value});
+  REQUIRE(ok.value);
+  CHECK(**ok.value == "ok");
+
+  const auto bad = fold(test_sender{test_sender::error});
+  REQUIRE(bad.value);
+  CHECK(bad.value->error() == 7);
+
+  const auto stopped = fold(test_sender{test_sender::stopped});
+  CHECK_FALSE(stopped.value);
+  CHECK(stopped.stopped);
+}
+
+TEST_CASE("Round trip through a sender", "[sender.round_trip]") {
+  using result = expected<int, int>;
+  std::optional<result> value;
+  std::optional<int> error;
+  bool stopped = false;
+
+  auto op = into_expected(from_expected(result(unexpect, 5)))
+                .connect(sink<result>{&value, &error, &stopped});
+  op.start();
+  REQUIRE(value);
+  CHECK(*value == result(unexpect, 5));
+  CHECK_FALSE(error);
+}
+
+namespace {
+struct throws_on_copy {
+  throws_on_copy() = default;
+  throws_on_copy(const throws_on_copy &) { throw 1; }
+};
+
+// Also takes exceptions, so into_expected can hand them on.
+struct exception_sink {
+  bool *done;
+  std::exception_ptr *exception;
+
+  void set_value(expected<throws_on_copy, int>) && noexcept { *done = true; }
+  void set_error(std::exception_ptr e) && noexcept { *exception = e; }
+  void set_stopped() && noexcept {}
+};
+
+struct copy_sender {
+  template <class R> struct operation {
+    R m_receiver;
+    void start() & noexcept {
+      const throws_on_copy value;
+      std::move(m_receiver).set_value(value);
+    }
+  };
+
+  template <class R> operation<R> connect(R r) const { return {std::move(r)}; }
+};
+} // namespace
+
+TEST_CASE("Exceptions building the expected reach set_error",
+          "[sender.exception]") {
+  bool done = false;
+  std::exception_ptr exception;
+  auto op = into_expected<throws_on_copy, int>(copy_sender{})
+                .connect(exception_sink{&done, &exception});
+  op.start();
+  CHECK_FALSE(done);
+  CHECK(exception);
+}
+
+namespace {
+struct env {
+  int stop_token;
+};
+
+struct env_sink {
+  std::optional<expected<int, int>> *value;
+  std::exception_ptr *exception;
+
+  void set_value(expected<int, int> v) && noexcept { value->emplace(v); }
+  void set_error(std::exception_ptr e) && noexcept { *exception = e; }
+  void set_stopped() && noexcept {}
+  env get_env() const noexcept { return {42}; }
+};
+
+// Reads the receiver's environment, then fails with an exception_ptr, which
+// int cannot hold.
+struct env_sender {
+  int *seen;
+
+  template <class R> struct operation {
+    int *m_seen;
+    R m_receiver;
+    void start() & noexcept {
+      *m_seen = m_receiver.get_env().stop_token;
+      std::move(m_receiver)
+          .set_error(std::make_exception_ptr(std::runtime_error("lost")));
+    }
+  };
+
+  template <class R> operation<R> connect(R r) const {
+    return {seen, std::move(r)};
+  }
+};
+} // namespace
+
+TEST_CASE("Unconvertible errors and the environment pass through",
+          "[sender.pass_through]") {
+  int seen = 0;
+  std::optional<expected<int, int>> value;
+  std::exception_ptr exception;
+  auto op = into_expected<int, int>(env_sender{&seen})
+                .connect(env_sink{&value, &exception});
+  op.start();
+  CHECK(seen == 42);
+  CHECK_FALSE(value);
+  REQUIRE(exception);
+  CHECK_THROWS_AS(std::rethrow_exception(exception), std::runtime_error);
+}
@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: CC0-1.0
+#include "catch.hpp"
+#include <atomic>
+#include <experimental/expected_shared_error.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::experimental::expected;
+using std::experimental::make_shared_unexpected;
+using std::experimental::refcount_policy;
+using std::experimental::shared_error;
+using std::experimental::unexpect;
+using std::experimental::update_error;
+
+namespace {
+struct big_error {
+  explicit big_error(std::string m) : message(std::move(m)) {}
+  std::string message;
+  std::vector<std::string> context;
+
+  friend bool operator==(const big_error &x, const big_error &y) {
+    return x.message == y.message && x.context == y.context;
+  }
+};
+} // namespace
+
+TEST_CASE("Propagating a shared error copies no payload",
+          "[shared_error.propagate]") {
+  using result = expected<int, shared_error<big_error>>;
+  result r = make_shared_unexpected<big_error>("disk full");
+  REQUIRE(r.error().use_count() == 1);
+
+  auto a = r.and_then([](int i) { return result(i); });
+  auto b = r.map([](int i) { return i + 1; });
+  result c = r;
+  REQUIRE(r.error().use_count() == 4);
+  REQUIRE(&a.error()->message == &r.error()->message);
+  REQUIRE(&b.error()->message == &r.error()->message);
+  REQUIRE(c.error() == r.error());
+  REQUIRE(r.error()->message == "disk full");
+}
+
+TEST_CASE("map_error copies on write", "[shared_error.cow]") {
+  using result = expected<int, shared_error<big_error>>;
+  result r = make_shared_unexpected<big_error>("disk full");
+  auto add = update_error([](big_error &e) { e.context.push_back("save"); });
+
+  auto shared = r.map_error(add);
+  REQUIRE(r.error()->context.empty());
+  REQUIRE(shared.error()->context.size() == 1);
+  REQUIRE(r.error().use_count() == 1);
+  REQUIRE(r.error() != shared.error());
+
+  const big_error *before = &*shared.error();
+  auto moved = std::move(shared).map_error(add);
+  REQUIRE(&*moved.error() == before);
+  REQUIRE(moved.error()->context.size() == 2);
+}
+
+TEST_CASE("Reference counting policies", "[shared_error.policy]") {
+  shared_error<std::string, refcount_policy::local> local("oops");
+  {
+    auto copy = local;
+    REQUIRE(local.use_count() == 2);
+    copy.mutate() += "!";
+    REQUIRE(*copy == "oops!");
+  }
+  REQUIRE(local.use_count() == 1);
+  REQUIRE(*local == "oops");
+
+  shared_error<std::string> shared("oops");
+  std::atomic<int> mismatches{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([shared, &mismatches] {
+      for (int i = 0; i < 10000; ++i) {
+        auto copy = shared;
+        mismatches += copy.error() != "oops";
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  REQUIRE(mismatches == 0);
+  REQUIRE(shared.use_count() == 1);
+}
+
+TEST_CASE("Moved-from shared errors", "[shared_error.moved]") {
+  using result = expected<int, shared_error<std::string>>;
+  result r = make_shared_unexpected<std::string>("gone");
+  auto taken = std::move(r).error();
+  CHECK(*taken == "gone");
+  CHECK(r.error().use_count() == 0);
+  CHECK(r.error() != taken);
+  CHECK(taken != r.error());
+
+  shared_error<std::string> other("gone");
+  auto moved = std::move(other);
+  CHECK(r.error() == other);
+  other = moved;
+  CHECK(other.use_count() == 2);
+  CHECK(other == taken);
+}
@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: CC0-1.0
+#include "catch.hpp"
+#include <experimental/expected_task.hpp>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <stdexcept>
+#include <string>
+
+using std::experimental::expected;
+using std::experimental::frame_pool;
+using std::experimental::run_loop;
+using std::experimental::task;
+using std::experimental::unexpect;
+using std::experimental::unexpected;
+
+namespace {
+task<int, std::string> leaf(int v) {
+  if (v < 0) {
+    co_await unexpected<std::string>("negative");
+  }
+  co_return v;
+}
+
+int resumed_after_error = 0;
+
+task<int, std::string> sum(int a, int b) {
+  int x = co_await leaf(a);
+  int y = co_await leaf(b);
+  ++resumed_after_error;
+  co_return x + y;
+}
+
+task<long, std::string> outer(int a, int b) {
+  long v = co_await sum(a, b);
+  ++resumed_after_error;
+  co_return v * 10;
+}
+
+task<int, std::string> chain(int depth) {
+  if (depth == 0) {
+    co_return 0;
+  }
+  co_return 1 + co_await chain(depth - 1);
+}
+
+task<void, int> fail_deep(int depth) {
+  if (depth == 0) {
+    co_await expected<void, int>(unexpect, 7);
+  } else {
+    co_await fail_deep(depth - 1);
+  }
+}
+
+task<int, int> throws() {
+  throw std::runtime_error("boom");
+  co_return 0;
+}
+} // namespace
+
+TEST_CASE("Task results and errors", "[task.basic]") {
+  CHECK(*sync_wait(outer(1, 2)) == 30);
+
+  resumed_after_error = 0;
+  auto ret = sync_wait(outer(1, -2));
+  REQUIRE_FALSE(ret);
+  CHECK(ret.error() == "negative");
+  CHECK(resumed_after_error == 0);
+
+  auto soft = [](int v) -> task<int, std::string> {
+    auto r = co_await leaf(v).as_expected();
+    co_return r ? *r : -1;
+  };
+  CHECK(*sync_wait(soft(-5)) == -1);
+  CHECK(*sync_wait(soft(5)) == 5);
+
+  CHECK_THROWS_AS(sync_wait(throws()), std::runtime_error);
+}
+
+TEST_CASE("Deep task chains", "[task.deep]") {
+  CHECK(*sync_wait(chain(10000)) == 10000);
+  CHECK(sync_wait(fail_deep(1000000)).error() == 7);
+}
+
+TEST_CASE("Task frames come from the pool", "[task.pool]") {
+  frame_pool pool;
+  {
+    frame_pool::scope scope(&pool);
+    CHECK(*sync_wait(chain(10)) == 10);
+  }
+  const auto first = pool.allocations();
+  CHECK(first > 0);
+  {
+    frame_pool::scope scope(&pool);
+    for (int i = 0; i < 100; ++i) {
+      CHECK(*sync_wait(chain(10)) == 10);
+      CHECK(*sync_wait(outer(i, i)) == 20 * i);
+    }
+  }
+  CHECK(pool.allocations() <= first + 3);
+  CHECK(frame_pool::current() == nullptr);
+}
+
+TEST_CASE("Run loop scheduling", "[task.loop]") {
+  run_loop loop;
+  std::string trace;
+  auto step = [&](char c, int n) -> task<int, std::string> {
+    for (int i = 0; i < n; ++i) {
+      trace += c;
+      co_await loop.schedule();
+    }
+    co_return n;
+  };
+  auto both = [&]() -> task<int, std::string> {
+    auto a = step('a', 3);
+    int x = co_await std::move(a);
+    int y = co_await step('b', 2);
+    co_return x + y;
+  };
+  CHECK(*loop.sync_wait(both()) == 5);
+  CHECK(trace == "aaabb");
+}
+#endif
@@ -0,0 +1,135 @@
+// SPDX-License-Identifier: CC0-1.0
+#include "catch.hpp"
+#include <experimental/expected_when_all.hpp>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+using std::experimental::cancellation_source;
+using std::experimental::cancellation_token;
+using std::experimental::expected;
+using std::experimental::frame_pool;
+using std::experimental::run_loop;
+using std::experimental::task;
+using std::experimental::thread_pool;
+using std::experimental::unexpected;
+
+namespace {
+task<int, std::string> value_after(int v, std::chrono::milliseconds delay) {
+  std::this_thread::sleep_for(delay);
+  co_return v;
+}
+
+task<int, std::string> fail_after(std::string what,
+                                  std::chrono::milliseconds delay) {
+  std::this_thread::sleep_for(delay);
+  co_await unexpected<std::string>(what);
+  co_return 0;
+}
+
+// Works in small steps, giving up once cancellation is requested.
+template <class Executor>
+task<int, std::string> slow(Executor &ex, cancellation_token token,
+                            std::atomic<int> &steps) {
+  for (int i = 0; i < 1000; ++i) {
+    if (token.is_cancellation_requested()) {
+      co_await unexpected<std::string>("cancelled");
+    }
+    ++steps;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    co_await ex.schedule();
+  }
+  co_return 1000;
+}
+
+task<int, std::string> countdown(int n) {
+  if (n == 0) {
+    co_return 0;
+  }
+  co_return 1 + co_await countdown(n - 1);
+}
+
+// Moves to a worker and reports the pool current there while it runs.
+task<int, std::string> hop(thread_pool &workers, frame_pool *&seen) {
+  co_await workers.schedule();
+  seen = frame_pool::current();
+  co_return co_await countdown(10);
+}
+} // namespace
+
+TEST_CASE("when_all on a thread pool", "[when_all.all]") {
+  using namespace std::chrono_literals;
+  thread_pool pool(4);
+  {
+    cancellation_source source;
+    auto ret = sync_wait(when_all(pool, source, value_after(1, 5ms),
+                                  value_after(2, 1ms), value_after(3, 0ms)));
+    REQUIRE(ret);
+    CHECK(*ret == std::make_tuple(1, 2, 3));
+    CHECK_FALSE(source.is_cancellation_requested());
+  }
+  {
+    cancellation_source source;
+    std::atomic<int> steps{0};
+    auto ret = sync_wait(when_all(pool, source,
+                                  slow(pool, source.token(), steps),
+                                  fail_after("shard down", 5ms),
+                                  value_after(3, 0ms)));
+    REQUIRE_FALSE(ret);
+    CHECK(ret.error() == "shard down");
+    CHECK(source.is_cancellation_requested());
+    CHECK(steps < 1000);
+  }
+}
+
+TEST_CASE("when_any on a thread pool", "[when_all.any]") {
+  using namespace std::chrono_literals;
+  thread_pool pool(3);
+  {
+    cancellation_source source;
+    std::atomic<int> steps{0};
+    auto ret = sync_wait(when_any(pool, source, fail_after("a", 0ms),
+                                  slow(pool, source.token(), steps),
+                                  value_after(7, 5ms)));
+    REQUIRE(ret);
+    CHECK(*ret == 7);
+    CHECK(steps < 1000);
+  }
+  {
+    cancellation_source source;
+    auto ret = sync_wait(when_any(pool, source, fail_after("a", 0ms),
+                                  fail_after("b", 20ms)));
+    REQUIRE_FALSE(ret);
+    CHECK(ret.error() == "b");
+  }
+}
+
+TEST_CASE("when_all on a run loop", "[when_all.loop]") {
+  run_loop loop;
+  cancellation_source source;
+  std::atomic<int> steps{0};
+  auto ret = loop.sync_wait(
+      when_all(loop, source, slow(loop, source.token(), steps),
+               fail_after("early", std::chrono::milliseconds(0))));
+  REQUIRE_FALSE(ret);
+  CHECK(ret.error() == "early");
+  CHECK(steps == 1);
+}
+TEST_CASE("Frame pools stay on their thread", "[when_all.pool]") {
+  frame_pool pool;
+  thread_pool workers(1);
+  frame_pool *seen = &pool;
+  {
+    frame_pool::scope scope(&pool);
+    CHECK(*sync_wait(hop(workers, seen)) == 10);
+    CHECK(frame_pool::current() == &pool);
+  }
+  CHECK(seen == nullptr);
+  // Only the frame made on this thread came from the pool.
+  CHECK(pool.allocations() == 1);
+  CHECK(frame_pool::current() == nullptr);
+}
+#endif